@@ -53,6 +53,17 @@ package body GNATLLVM.Blocks is
      Size   : GL_Value;
    end record;
 
+   --  We also record a list of variables containing the address of memory
+   --  allocated on the heap for objects local to a block, which we must
+   --  free when we leave the block.
+
+   type Heap_Data;
+   type A_Heap_Data is access Heap_Data;
+   type Heap_Data is record
+     Next : A_Heap_Data;
+     Slot : GL_Value;
+   end record;
+
    --  This data structure records the information about each block that
    --  we're in and we construct a table to act as a block stack.
 
@@ -103,8 +114,16 @@ package body GNATLLVM.Blocks is
       --  List of memory locations whose lifetimes end at the end of this
       --  block.
 
+      Heap_List          : A_Heap_Data;
+      --  List of variables pointing to heap memory to be freed at normal
+      --  or abnormal exit of the block.
+
    end record;
 
+   function Has_At_End (BI : Block_Info) return Boolean is
+     (Present (BI.At_End_Proc) or else BI.Heap_List /= null);
+   --  True if we have something to do at any exit from the block
+
    type Block_Stack_Level is new Integer;
    --  Type to record depth of block stack
 
@@ -190,6 +209,9 @@ package body GNATLLVM.Blocks is
 
       From_Block   : Block_Stack_Level;
       --  The starting block depth of Exit_BB
+
+      Hints        : Loop_Hints;
+      --  The hints given for this loop by pragma Loop_Optimize
    end record;
 
    type Exit_Point_Level is new Integer;
@@ -301,9 +323,10 @@ package body GNATLLVM.Blocks is
 
    procedure Call_At_End
      (Block : Block_Stack_Level; For_Exception : Boolean := False);
-   --  Call the At_End procedure of Block, if any.  If For_Exception is True,
-   --  this is the exception case.  This only matters when At_End_Pass_Excptr
-   --  is set, which is only for the End_Handler.
+   --  Call the At_End procedure of Block, if any, and free the heap memory
+   --  of its objects.  If For_Exception is True, this is the exception
+   --  case.  This only matters when At_End_Pass_Excptr is set, which is
+   --  only for the End_Handler.
 
    procedure Build_Fixups_From_To (From, To : Block_Stack_Level);
    --  We're currently in block From and going to block To.  Call any
@@ -451,7 +474,8 @@ package body GNATLLVM.Blocks is
                            Unprotected        => False,
                            At_Entry_Start     =>
                              Get_Current_Position = Entry_Block_Allocas,
-                           Lifetime_List      => null));
+                           Lifetime_List      => null,
+                           Heap_List          => null));
 
    end Push_Block;
 
@@ -530,6 +554,50 @@ package body GNATLLVM.Blocks is
 
    end Add_Lifetime_Entry;
 
+   ---------------------------
+   -- Can_Free_At_Block_End --
+   ---------------------------
+
+   function Can_Free_At_Block_End return Boolean is
+   begin
+      --  We can't free memory when leaving a block if there's no block
+      --  or if we're generating C.  We also don't try to do it in a block
+      --  with exception handlers, since the handlers may be executed
+      --  without going through the code to exit the block.
+
+      return not Emit_C and then Block_Stack.Last > 0
+        and then No (Block_Stack.Table (Block_Stack.Last).EH_List);
+   end Can_Free_At_Block_End;
+
+   --------------------
+   -- Add_Heap_Entry --
+   --------------------
+
+   procedure Add_Heap_Entry (Ptr : GL_Value) is
+      BI     : Block_Info renames Block_Stack.Table (Block_Stack.Last);
+      Our_BB : constant Basic_Block_T := Get_Insert_Block;
+      Slot   : constant GL_Value      := Alloca (A_Char_GL_Type);
+
+   begin
+      --  Make a variable to hold the address of the memory and clear it at
+      --  the start of the block, as we do for lifetimes above, since we
+      --  may leave the block before we get here.
+
+      Set_Current_Position
+        ((if   BI.At_Entry_Start then Entry_Block_Allocas
+          else BI.Starting_Position));
+      Store (Const_Null (A_Char_GL_Type), Slot);
+      Position_Builder_At_End (Our_BB);
+
+      --  If we get here more than once before leaving the block, for
+      --  example because this is in a loop, the memory we allocated the
+      --  previous time can no longer be accessed, so free it.
+
+      Call (Get_Default_Free_Fn, (1 => Load (Slot)));
+      Store (Ptr, Slot);
+      BI.Heap_List := new Heap_Data'(BI.Heap_List, Slot);
+   end Add_Heap_Entry;
+
    ---------------------
    -- Get_Landing_Pad --
    ---------------------
@@ -543,7 +611,7 @@ package body GNATLLVM.Blocks is
 
       for J in reverse 1 .. Block_Stack.Last loop
          BI := Block_Stack.Table (J);
-         if (Present (BI.EH_List) or else Present (BI.At_End_Proc))
+         if (Present (BI.EH_List) or else Has_At_End (BI))
            and then not BI.Unprotected
          then
             if No (BI.Landing_Pad) then
@@ -577,6 +645,7 @@ package body GNATLLVM.Blocks is
       Unprotected : constant Boolean   := Our_BI.Unprotected;
       Params      : GL_Value_Array (1 .. 3);
       Last_Param  : Nat                := 0;
+      Heaps       : A_Heap_Data        := BI.Heap_List;
 
       ---------------------
       -- Push_If_Present --
@@ -591,14 +660,23 @@ package body GNATLLVM.Blocks is
       end Push_If_Present;
 
    begin
+      Our_BI.Unprotected := True;
       if Present (BI.At_End_Proc) then
          Push_If_Present (BI.At_End_Parameter);
          Push_If_Present (BI.At_End_Parameter_2);
          Push_If_Present (Our_Exc_Ptr);
-         Our_BI.Unprotected := True;
          Call (BI.At_End_Proc, Params (1 .. Last_Param));
-         Our_BI.Unprotected := Unprotected;
       end if;
+
+      --  Then free any memory allocated for objects in the block, which
+      --  the At_End_Proc may have finalized.
+
+      while Heaps /= null loop
+         Call (Get_Default_Free_Fn, (1 => Load (Heaps.Slot)));
+         Heaps := Heaps.Next;
+      end loop;
+
+      Our_BI.Unprotected := Unprotected;
    end Call_At_End;
 
    -------------------------
@@ -677,6 +755,12 @@ package body GNATLLVM.Blocks is
                              Fn_Ty ((1 => Void_Ptr_T), Void_Ptr_T),
                              A_Char_GL_Type);
 
+      --  Exception handlers are rarely executed, so say that the call
+      --  that starts each of them is cold.  That allows the optimizer to
+      --  treat the handler as cold code and move it out of the hot path.
+
+      Add_Cold_Attribute (Begin_Handler_Fn);
+
       End_Handler_Fn   :=
         Add_Global_Function ("__gnat_end_handler_v1",
                              Fn_Ty ((1 => Void_Ptr_T, 2 => Void_Ptr_T,
@@ -1002,7 +1086,7 @@ package body GNATLLVM.Blocks is
       LP_Type           : constant Type_T        := Get_LP_Type;
       Have_Cleanup      : constant Boolean       :=
         (for some J in 1 .. Block =>
-           Present (Block_Stack.Table (J).At_End_Proc)
+           Has_At_End (Block_Stack.Table (J))
            and then (not Block_Stack.Table (J).Unprotected or else J = Block));
       LP_Inst           : GL_Value               := No_GL_Value;
       N_Dispatch_Froms  : Nat                    :=
@@ -1297,7 +1381,7 @@ package body GNATLLVM.Blocks is
             BI : Block_Info renames Block_Stack.Table (J);
 
          begin
-            if (Present (BI.At_End_Proc) or else Present (BI.EH_List))
+            if (Has_At_End (BI) or else Present (BI.EH_List))
               and then not BI.Unprotected
             then
                if No (BI.Dispatch_BB) then
@@ -1336,9 +1420,13 @@ package body GNATLLVM.Blocks is
         (if EH_Work and then not At_Dead then Create_Basic_Block else No_BB_T);
       Lifetimes : A_Lifetime_Data            := BI.Lifetime_List;
       Next      : A_Lifetime_Data;
+      Heaps     : A_Heap_Data                := BI.Heap_List;
+      Next_Heap : A_Heap_Data;
 
       procedure Free is new Ada.Unchecked_Deallocation (Lifetime_Data,
                                                         A_Lifetime_Data);
+      procedure Free is new Ada.Unchecked_Deallocation (Heap_Data,
+                                                        A_Heap_Data);
    begin
       --  If we're not in dead code, we have to fixup the block and the branch
       --  around any landingpad.  But that code is not protected by any
@@ -1403,6 +1491,14 @@ package body GNATLLVM.Blocks is
          Lifetimes := Next;
       end loop;
 
+      --  Likewise for the heap data
+
+      while Heaps /= null loop
+         Next_Heap := Heaps.Next;
+         Free (Heaps);
+         Heaps := Next_Heap;
+      end loop;
+
       --  And finally pop our stack
 
       Block_Stack.Decrement_Last;
@@ -1722,7 +1818,8 @@ package body GNATLLVM.Blocks is
                            Block_Depth  => Block_Stack.Last,
                            Orig_BB      => Exit_Point,
                            Exit_BB      => No_BB_T,
-                           From_Block   => -1));
+                           From_Block   => -1,
+                           Hints        => No_Loop_Hints));
    end Push_Loop;
 
    --------------
@@ -1734,6 +1831,25 @@ package body GNATLLVM.Blocks is
       Exit_Points.Decrement_Last;
    end Pop_Loop;
 
+   -------------------
+   -- Add_Loop_Hint --
+   -------------------
+
+   procedure Add_Loop_Hint (H : Loop_Hint) is
+   begin
+      if Exit_Points.Last >= Exit_Point_Low_Bound then
+         Exit_Points.Table (Exit_Points.Last).Hints (H) := True;
+      end if;
+   end Add_Loop_Hint;
+
+   --------------------
+   -- Get_Loop_Hints --
+   --------------------
+
+   function Get_Loop_Hints return Loop_Hints is
+     (if   Exit_Points.Last >= Exit_Point_Low_Bound
+      then Exit_Points.Table (Exit_Points.Last).Hints else No_Loop_Hints);
+
    ---------------------
    -- Find_Exit_Point --
    ---------------------
@@ -24,16 +24,15 @@ with System;            use System;
 with System.OS_Lib;     use System.OS_Lib;
 
 with LLVM.Analysis;   use LLVM.Analysis;
-with LLVM.Bit_Reader; use LLVM.Bit_Reader;
 with LLVM.Bit_Writer; use LLVM.Bit_Writer;
 with LLVM.Debug_Info; use LLVM.Debug_Info;
-with LLVM.Linker;     use LLVM.Linker;
 with LLVM.Support;    use LLVM.Support;
 
 with CCG; use CCG;
 
 with Debug;    use Debug;
 with Errout;   use Errout;
+with Gnatvsn;  use Gnatvsn;
 with Set_Targ; use Set_Targ;
 with Lib;      use Lib;
 with Opt;      use Opt;
@@ -75,6 +74,22 @@ package body GNATLLVM.Codegen is
    procedure Process_Switch (Switch : String);
    --  Process one command-line switch
 
+   function Has_Prefix (S, Prefix : String) return Boolean is
+     (S'Length >= Prefix'Length
+        and then S (S'First .. S'First + Prefix'Length - 1) = Prefix);
+   --  Return True if S starts with Prefix
+
+   function Cache_Key_Options return String;
+   --  Return a description of everything other than the module itself and
+   --  other input files that affects the output of this compilation, for
+   --  use in computing its key in the compilation cache. This includes
+   --  the optimization levels, which aren't back-end switches and barely
+   --  affect the unoptimized module.
+
+   function Cache_Key_Files return String;
+   --  Return the names of the input files other than the module that
+   --  affect the output of this compilation, each followed by a newline.
+
    --------------------
    -- Process_Switch --
    --------------------
@@ -98,6 +113,23 @@ package body GNATLLVM.Codegen is
         ((if S1 = "" then S1 else S1 & ",") & S2);
       --  Concatenate S1 and S2, putting a comma in between if S1 is empty
 
+      function Switch_Nat_Value (S : String) return Nat;
+      --  Returns the value of a switch known to start with S, which must
+      --  be a natural number
+
+      ----------------------
+      -- Switch_Nat_Value --
+      ----------------------
+
+      function Switch_Nat_Value (S : String) return Nat is
+      begin
+         return Nat'Value (Switch_Value (S));
+      exception
+         when Constraint_Error =>
+            Early_Error ("invalid value in switch " & Switch);
+            return 0;
+      end Switch_Nat_Value;
+
    begin
       --  ??? At some point, this and Is_Back_End_Switch need to have
       --  some sort of common code.
@@ -221,6 +253,10 @@ package body GNATLLVM.Codegen is
          No_Strict_Aliasing_Flag := True;
       elsif Switch = "-fc-style-aliasing" then
          C_Style_Aliasing := True;
+      elsif Switch = "-fno-range-metadata" then
+         Range_Metadata := False;
+      elsif Switch = "-frange-metadata" then
+         Range_Metadata := True;
       elsif Switch = "-fno-unroll-loops" then
          No_Unroll_Loops := True;
       elsif Switch = "-funroll-loops" then
@@ -233,6 +269,14 @@ package body GNATLLVM.Codegen is
          No_SLP_Vectorization := True;
       elsif Switch = "-fslp-vectorize" then
          No_SLP_Vectorization := False;
+      elsif Switch = "-fno-loop-check-versioning" then
+         No_Check_Versioning := True;
+      elsif Switch = "-floop-check-versioning" then
+         No_Check_Versioning := False;
+      elsif Switch = "-fno-reorder-blocks-and-partition" then
+         No_Hot_Cold_Split := True;
+      elsif Switch = "-freorder-blocks-and-partition" then
+         No_Hot_Cold_Split := False;
       elsif Switch = "-fno-inline" then
          No_Inlining := True;
       elsif Switch = "-fmerge-functions" then
@@ -248,6 +292,10 @@ package body GNATLLVM.Codegen is
       elsif Switch = "-flto=thin" then
          Prepare_For_Thin_LTO  := True;
          Prepare_For_LTO       := False;
+      elsif Switch = "-fwhole-program-vtables" then
+         Whole_Program_Vtables := True;
+      elsif Switch = "-fno-whole-program-vtables" then
+         Whole_Program_Vtables := False;
       elsif Switch = "-freroll-loops" then
          Reroll_Loops := True;
       elsif Switch = "-fno-reroll-loops" then
@@ -283,6 +331,151 @@ package body GNATLLVM.Codegen is
       elsif Starts_With ("-fpass-plugin=") then
          To_Free := Pass_Plugin_Name;
          Pass_Plugin_Name := new String'(Switch_Value ("-fpass-plugin="));
+
+      --  -fprofile-generate and -fprofile-use are as in clang: the
+      --  operand, if any, is either a file or a directory in which a
+      --  default name is used.
+
+      elsif Switch = "-fprofile-generate" then
+         Free (Profile_Use_File);
+         To_Free               := Profile_Generate_File;
+         Profile_Generate_File := new String'("default_%m.profraw");
+      elsif Starts_With ("-fprofile-generate=") then
+         Free (Profile_Use_File);
+         To_Free               := Profile_Generate_File;
+         Profile_Generate_File :=
+           new String'(Switch_Value ("-fprofile-generate=") &
+                       Directory_Separator & "default_%m.profraw");
+      elsif Switch = "-fno-profile-generate" then
+         To_Free := Profile_Generate_File;
+         Profile_Generate_File := null;
+      elsif Switch = "-fprofile-use" then
+         Free (Profile_Generate_File);
+         To_Free          := Profile_Use_File;
+         Profile_Use_File := new String'("default.profdata");
+      elsif Starts_With ("-fprofile-use=") then
+         Free (Profile_Generate_File);
+         To_Free          := Profile_Use_File;
+         Profile_Use_File :=
+           new String'((if   Is_Directory (Switch_Value ("-fprofile-use="))
+                        then Switch_Value ("-fprofile-use=") &
+                             Directory_Separator & "default.profdata"
+                        else Switch_Value ("-fprofile-use=")));
+      elsif Switch = "-fno-profile-use" then
+         To_Free := Profile_Use_File;
+         Profile_Use_File := null;
+
+      --  We accept both the clang and GCC names for using a sampled profile
+
+      elsif Starts_With ("-fprofile-sample-use=") then
+         To_Free                 := Profile_Sample_Use_File;
+         Profile_Sample_Use_File :=
+           new String'(Switch_Value ("-fprofile-sample-use="));
+      elsif Starts_With ("-fauto-profile=") then
+         To_Free                 := Profile_Sample_Use_File;
+         Profile_Sample_Use_File :=
+           new String'(Switch_Value ("-fauto-profile="));
+      elsif Switch in "-fno-profile-sample-use" | "-fno-auto-profile" then
+         To_Free := Profile_Sample_Use_File;
+         Profile_Sample_Use_File := null;
+      elsif Switch = "-ftime-report" then
+         Time_Report := True;
+      elsif Switch = "-ftime-trace" then
+         Time_Trace := True;
+      elsif Starts_With ("-ftime-trace=") then
+         To_Free         := Time_Trace_File;
+         Time_Trace      := True;
+         Time_Trace_File := new String'(Switch_Value ("-ftime-trace="));
+      elsif Starts_With ("-ftime-trace-granularity=") then
+         Time_Trace_Granularity :=
+           Switch_Nat_Value ("-ftime-trace-granularity=");
+      elsif Switch = "-fmachine-outliner" then
+         Outline_Code    := True;
+         No_Outline_Code := False;
+      elsif Switch = "-fno-machine-outliner" then
+         Outline_Code    := False;
+         No_Outline_Code := True;
+      elsif Switch = "-fsize-report" then
+         Size_Report := True;
+      elsif Starts_With ("-fsize-report=") then
+         To_Free          := Size_Report_File;
+         Size_Report      := True;
+         Size_Report_File := new String'(Switch_Value ("-fsize-report="));
+      elsif Switch = "-fembed-bitcode" then
+         Embed_Bitcode := True;
+      elsif Switch = "-fno-embed-bitcode" then
+         Embed_Bitcode := False;
+      elsif Switch = "-fsave-bitcode" then
+         Save_Bitcode := True;
+      elsif Starts_With ("-fsave-bitcode=") then
+         To_Free           := Save_Bitcode_File;
+         Save_Bitcode      := True;
+         Save_Bitcode_File := new String'(Switch_Value ("-fsave-bitcode="));
+      elsif Switch = "-fno-save-bitcode" then
+         Save_Bitcode := False;
+      elsif Starts_With ("-fcache-dir=") then
+         To_Free   := Cache_Dir;
+         Cache_Dir := new String'(Switch_Value ("-fcache-dir="));
+      elsif Starts_With ("-fheap-allocation-threshold=") then
+         Heap_Allocation_Threshold :=
+           Switch_Nat_Value ("-fheap-allocation-threshold=");
+      elsif Starts_With ("-fcodegen-jobs=") then
+         Code_Gen_Jobs := Nat'Max (Switch_Nat_Value ("-fcodegen-jobs="), 1);
+      elsif Starts_With ("-fveclib=") then
+         declare
+            Lib : constant String := Switch_Value ("-fveclib=");
+
+         begin
+            if Lib = "none" then
+               Vector_Library := No_Vector_Library;
+            elsif Lib = "Accelerate" then
+               Vector_Library := Accelerate;
+            elsif Lib = "Darwin_libsystem_m" then
+               Vector_Library := Darwin_Libsystem_M;
+            elsif Lib = "libmvec" then
+               Vector_Library := Libmvec_X86;
+            elsif Lib = "MASSV" then
+               Vector_Library := MASSV;
+            elsif Lib = "SVML" then
+               Vector_Library := SVML;
+            else
+               Early_Error ("unsupported vector library: " & Lib);
+            end if;
+         end;
+      elsif Switch = "-fno-builtin" then
+         No_Builtins := True;
+      elsif Switch = "-fbuiltin" then
+         No_Builtins := False;
+      elsif Starts_With ("-fno-builtin-") then
+         To_Free              := No_Builtin_Functions;
+         No_Builtin_Functions :=
+           new String'(Add_Maybe_With_Comma
+                         ((if   No_Builtin_Functions = null then ""
+                           else No_Builtin_Functions.all),
+                          Switch_Value ("-fno-builtin-")));
+      elsif Switch = "-fsave-optimization-record" then
+         Save_Optimization_Record := True;
+      elsif Starts_With ("-fsave-optimization-record=") then
+         To_Free                    := Optimization_Record_Format;
+         Save_Optimization_Record   := True;
+         Optimization_Record_Format :=
+           new String'(Switch_Value ("-fsave-optimization-record="));
+      elsif Switch = "-fno-save-optimization-record" then
+         Save_Optimization_Record := False;
+      elsif Starts_With ("-foptimization-record-file=") then
+         To_Free                  := Optimization_Record_File;
+         Save_Optimization_Record := True;
+         Optimization_Record_File :=
+           new String'(Switch_Value ("-foptimization-record-file="));
+      elsif Starts_With ("-foptimization-record-passes=") then
+         To_Free                    := Optimization_Record_Passes;
+         Save_Optimization_Record   := True;
+         Optimization_Record_Passes :=
+           new String'(Switch_Value ("-foptimization-record-passes="));
+      elsif Switch = "-fdebug-info-for-profiling" then
+         Debug_Info_For_Profiling := True;
+      elsif Switch = "-fno-debug-info-for-profiling" then
+         Debug_Info_For_Profiling := False;
       elsif Starts_With ("-llvm-") then
          Switches.Append (new String'(Switch_Value ("-llvm")));
       elsif C_Process_Switch (Switch) then
@@ -307,6 +500,61 @@ package body GNATLLVM.Codegen is
          Process_Switch (Argument (J));
       end loop;
 
+      --  If we've been asked to use a profile, it must exist
+
+      if Profile_Use_File /= null
+        and then not Is_Regular_File (Profile_Use_File.all)
+      then
+         Early_Error ("cannot read profile `" & Profile_Use_File.all & "`");
+      end if;
+
+      --  A sampled profile is mapped back to the code using line number
+      --  information, so we need to generate at least that and we want
+      --  it to contain discriminators.  The same is true if we're asked to
+      --  produce code whose execution will be sampled to make such a
+      --  profile.
+
+      if Profile_Sample_Use_File /= null then
+         if not Is_Regular_File (Profile_Sample_Use_File.all) then
+            Early_Error ("cannot read profile `" &
+                           Profile_Sample_Use_File.all & "`");
+         end if;
+
+         Debug_Info_For_Profiling := True;
+      end if;
+
+      if Debug_Info_For_Profiling then
+         Emit_Debug_Info := True;
+      end if;
+
+      --  Optimization remarks are only useful if they can be related to
+      --  the source, so we need to track source locations.  But we don't
+      --  want that to change the output if no debugging info was asked for.
+
+      if Save_Optimization_Record and then not Emit_Debug_Info then
+         Emit_Debug_Info      := True;
+         Debug_Locations_Only := True;
+      end if;
+
+      Initialize_Timing (Time_Report, Time_Trace, Time_Trace_Granularity);
+
+      --  Devirtualization of dispatching calls is done when linking, so we
+      --  only need to prepare for it when the link uses LTO.
+
+      if not Prepare_For_LTO and then not Prepare_For_Thin_LTO then
+         Whole_Program_Vtables := False;
+      end if;
+
+      --  When optimizing for size, outline repeated code sequences in
+      --  each function, as clang does with -moutline, unless told not to.
+
+      if (Outline_Code
+          or else (Size_Opt_Level > 0 and then Code_Opt_Level > 0))
+        and then not No_Outline_Code
+      then
+         Switches.Append (new String'("-enable-machine-outliner" & ASCII.NUL));
+      end if;
+
       --  If emitting C, change some other defaults
 
       if Emit_C then
@@ -377,6 +625,8 @@ package body GNATLLVM.Codegen is
       TT_First    : constant Integer  := Target_Triple'First;
 
    begin
+      Start_Phase_Timer ("target initialization");
+
       if Target_Triple'Length >= 3 and then
         Target_Triple (TT_First .. TT_First + 2) = "bpf"
       then
@@ -411,8 +661,10 @@ package body GNATLLVM.Codegen is
             Addrs (J + Num_Builtin) := Switches.Table (J).all'Address;
          end loop;
 
+         Start_Phase_Timer ("option parsing");
          Parse_Command_Line_Options (Switches.Last + Num_Builtin,
                                      Addrs'Address, "");
+         Stop_Phase_Timer;
       end;
       --  Finalize our compilation mode now that all switches are parsed
 
@@ -431,7 +683,9 @@ package body GNATLLVM.Codegen is
 
       --  Initialize the translation environment
 
-      Initialize_LLVM;
+      Start_Phase_Timer ("target registration");
+      Initialize_LLVM (Target_Triple.all);
+      Stop_Phase_Timer;
       IR_Builder     := Create_Builder;
       MD_Builder     := Create_MDBuilder;
       Module         := Module_Create_With_Name (Filename.all);
@@ -444,6 +698,7 @@ package body GNATLLVM.Codegen is
                         Get_LLVM_Error_Msg (Ptr_Err_Msg));
       end if;
 
+      Start_Phase_Timer ("target machine creation");
       Target_Machine    :=
         Create_Target_Machine
           (T          => LLVM_Target,
@@ -453,6 +708,7 @@ package body GNATLLVM.Codegen is
            Level      => Code_Gen_Level,
            Reloc      => Reloc_Mode,
            Code_Model => Code_Model);
+      Stop_Phase_Timer;
 
       --  If a target layout was specified, use it. Otherwise, use the default
       --  layout for the specified target.
@@ -477,6 +733,12 @@ package body GNATLLVM.Codegen is
       then
          Force_Activation_Record_Parameter := True;
       end if;
+
+      --  What follows, until we're called to translate the tree, is
+      --  processing by the front end.
+
+      Stop_Phase_Timer;
+      Start_Phase_Timer ("front end");
    end Initialize_LLVM_Target;
 
    -------------------
@@ -484,9 +746,24 @@ package body GNATLLVM.Codegen is
    -------------------
 
    procedure Generate_Code (GNAT_Root : N_Compilation_Unit_Id) is
-      TT_First : constant Integer  := Target_Triple'First;
-      Verified : Boolean           := True;
-      Err_Msg  : aliased Ptr_Err_Msg_Type;
+      function Output_Extension return String is
+        (case Code_Generation is
+           when Write_BC       => ".bc",
+           when Write_Assembly => ".s",
+           when others         => ".o");
+      --  The extension of the output file we're writing
+
+      TT_First   : constant Integer  := Target_Triple'First;
+      Verified   : Boolean           := True;
+      Err_Msg    : aliased Ptr_Err_Msg_Type;
+      Cache_File : String_Access     := null;
+      From_Cache : Boolean           := False;
+      --  If we're using the compilation cache, the file in it that holds
+      --  the output of this compilation and whether we found it there
+
+      Writing_Object : constant Boolean := Code_Generation = Write_Object;
+      --  True if we're to write an object file, whether by generating
+      --  code or by copying it from the cache
 
    begin
       --  We always want to write IR, even if there were errors.
@@ -494,8 +771,10 @@ package body GNATLLVM.Codegen is
       --  for decls.
 
       if not Decls_Only then
+         Start_Phase_Timer ("verification");
          Verified :=
            not Verify_Module (Module, Print_Message_Action, Null_Address);
+         Stop_Phase_Timer;
       end if;
 
       --  Unless just writing IR, suppress doing anything else if it fails
@@ -507,11 +786,71 @@ package body GNATLLVM.Codegen is
          Code_Generation := None;
       end if;
 
+      --  Make the clones of subprograms that we've been asked to compile
+      --  for several sets of processor features. This can't be expressed
+      --  in C.
+
+      if not Decls_Only and then Verified and then not Emit_C
+        and then Serious_Errors_Detected = 0
+        and then Expand_Target_Clones (Module, Features.all, Err_Msg'Address)
+      then
+         Error_Msg_N (Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
+      end if;
+
+      --  If we're using the compilation cache, see if the output of this
+      --  compilation is already there. We have to compute the key before
+      --  we change the module by optimizing it. We don't use the cache if
+      --  asked for optimization remarks or a bitcode file alongside the
+      --  output, since we wouldn't have them.
+
+      if Cache_Dir /= null and then not Decls_Only and then Verified
+        and then Serious_Errors_Detected = 0
+        and then Code_Generation in Write_BC | Write_Assembly | Write_Object
+        and then not Save_Optimization_Record and then not Save_Bitcode
+      then
+         Cache_File :=
+           new String'(Cache_Dir.all & Directory_Separator &
+                         Get_Module_Cache_Key (Module, Cache_Key_Options,
+                                               Cache_Key_Files) &
+                         Output_Extension);
+         From_Cache :=
+           Copy_From_Cache (Cache_File.all,
+                            Output_File_Name (Output_Extension));
+         if From_Cache then
+            Code_Generation := None;
+         end if;
+      end if;
+
+      --  If requested, arrange to save the remarks from the optimizer and
+      --  code generator.
+
+      if Save_Optimization_Record and then not Decls_Only then
+         declare
+            Record_File : constant String :=
+              (if   Optimization_Record_File /= null
+               then Optimization_Record_File.all
+               else Output_File_Name (".opt." &
+                                        Optimization_Record_Format.all));
+
+         begin
+            if Initialize_Optimization_Remarks
+              (Module, Record_File, Optimization_Record_Passes,
+               Optimization_Record_Format.all,
+               Profile_Use_File /= null
+                 or else Profile_Sample_Use_File /= null,
+               Err_Msg'Address)
+            then
+               Error_Msg_N ("could not write `" & Record_File & "`: " &
+                              Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
+            end if;
+         end;
+      end if;
+
       --  If we're generating code or being asked to optimize IR before
       --  writing it, perform optimization. But don't do this if just
       --  generating decls.
 
-      if not Decls_Only
+      if not Decls_Only and then not From_Cache
         and then (Code_Generation in Write_Assembly | Write_Object | Write_C
                     or else Optimize_IR)
       then
@@ -520,51 +859,14 @@ package body GNATLLVM.Codegen is
 
          if Target_Triple'Length >= 7
            and then Target_Triple (TT_First .. TT_First + 6) = "nvptx64"
+           and then Link_Libdevice (Module, Libdevice_Filename.all,
+                                    Err_Msg'Address)
          then
-            declare
-               Mem_Buffer    : aliased Memory_Buffer_T;
-               Libdev_Module : aliased Module_T;
-               Func          : Value_T;
-
-            begin
-               --  Read the file into a new module
-
-               if Create_Memory_Buffer_With_Contents_Of_File
-                 (Libdevice_Filename.all, Mem_Buffer'Address, Err_Msg'Address)
-               then
-                  Error_Msg_N ("could not read `" & Libdevice_Filename.all &
-                               "`: " & Get_LLVM_Error_Msg (Err_Msg),
-                               GNAT_Root);
-               elsif Parse_Bitcode_2 (Mem_Buffer, Libdev_Module'Address) then
-                  Error_Msg_N ("could not parse `" & Libdevice_Filename.all &
-                               "`", GNAT_Root);
-               else
-                  --  Set the data layout and target triple of the math
-                  --  library to agree with us and set the linkage of all
-                  --  functions so that we won't retain unused ones. Also
-                  --  mark each as Inline_Always.
-
-                  Set_Data_Layout (Libdev_Module, Get_Data_Layout (Module));
-                  Set_Target      (Libdev_Module, Get_Target (Module));
-                  Func := Get_First_Function (Libdev_Module);
-                  while Present (Func) loop
-                     Set_Linkage (Func, Available_Externally_Linkage);
-                     Add_Inline_Always_Attribute (Func);
-                     Func := Get_Next_Function (Func);
-                  end loop;
-
-                  --  Finally, put all of the math library into our module
-
-                  if Link_Modules_2 (Module, Libdev_Module) then
-                     Error_Msg_N ("could not merge `" &
-                                  Libdevice_Filename.all & "`",
-                                  GNAT_Root);
-                  end if;
-               end if;
-            end;
+            Error_Msg_N (Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
          end if;
 
          if Verified then
+            Start_Phase_Timer ("optimization");
             if LLVM_Optimize_Module
               (Module, Target_Machine,
                Code_Opt_Level        => Code_Opt_Level,
@@ -578,17 +880,56 @@ package body GNATLLVM.Codegen is
                Prepare_For_LTO       => Prepare_For_LTO,
                Reroll_Loops          => Reroll_Loops,
                Pass_Plugin_Name      => Pass_Plugin_Name,
+               Profile_Gen_File      => Profile_Generate_File,
+               Profile_Use_File      => Profile_Use_File,
+               Sample_Use_File       => Profile_Sample_Use_File,
+               Debug_Info_For_Prof   => Debug_Info_For_Profiling,
+               Vector_Library        => Vector_Library_Kind'Pos
+                                          (Vector_Library),
+               No_Builtins           => No_Builtins,
+               No_Builtin_Functions  => No_Builtin_Functions,
+               No_Check_Versioning   => No_Check_Versioning,
+               No_Hot_Cold_Split     => No_Hot_Cold_Split,
                Error_Message         => Err_Msg'Address)
             then
                Error_Msg_N ("could not optimize: " &
                               Get_LLVM_Error_Msg (Err_Msg),
                             GNAT_Root);
             end if;
+
+            Stop_Phase_Timer;
          end if;
       end if;
 
       --  Output the translation
 
+      Start_Phase_Timer ("code generation");
+
+      --  If asked to, write the optimized module as bitcode alongside the
+      --  assembly or object file we're about to generate and embed it in
+      --  that file. We must write it first so that it doesn't contain
+      --  itself.
+
+      if Code_Generation in Write_Assembly | Write_Object then
+         if Save_Bitcode then
+            declare
+               BC_File : constant String :=
+                 (if   Save_Bitcode_File /= null then Save_Bitcode_File.all
+                  else Output_File_Name (".bc"));
+
+            begin
+               if Integer (Write_Bitcode_To_File (Module, BC_File)) /= 0 then
+                  Error_Msg_N ("could not write `" & BC_File & "`",
+                               GNAT_Root);
+               end if;
+            end;
+         end if;
+
+         if Embed_Bitcode then
+            Embed_Module_Bitcode (Module);
+         end if;
+      end if;
+
       case Code_Generation is
          when Dump_IR =>
             Dump_Module (Module);
@@ -617,8 +958,8 @@ package body GNATLLVM.Codegen is
             S : constant String := Output_File_Name (".s");
 
          begin
-            if Target_Machine_Emit_To_File
-              (Target_Machine, Module, S, Assembly_File, Err_Msg'Address)
+            if Emit_To_File_Buffered
+              (Module, Target_Machine, S, Assembly_File, Err_Msg'Address)
             then
                Error_Msg_N ("could not write `" & S & "`: " &
                               Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
@@ -629,8 +970,21 @@ package body GNATLLVM.Codegen is
             S : constant String := Output_File_Name (".o");
 
          begin
-            if Target_Machine_Emit_To_File (Target_Machine, Module, S,
-                                            Object_File, Err_Msg'Address)
+            --  If asked to, split the module and generate code for the
+            --  pieces in parallel. We can't time the passes that generate
+            --  code in several threads at once, since their timers are
+            --  shared.
+
+            if Code_Gen_Jobs > 1 and then not Time_Report then
+               if Emit_Object_In_Parallel (Module, Target_Machine,
+                                           Code_Gen_Jobs, S, Err_Msg'Address)
+               then
+                  Error_Msg_N ("could not write `" & S & "`: " &
+                                 Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
+               end if;
+
+            elsif Emit_To_File_Buffered (Module, Target_Machine, S,
+                                         Object_File, Err_Msg'Address)
             then
                Error_Msg_N ("could not write `" & S & "`: " &
                               Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
@@ -644,6 +998,59 @@ package body GNATLLVM.Codegen is
             null;
       end case;
 
+      Stop_Phase_Timer;
+
+      --  If we've just written output that we didn't find in the cache,
+      --  save it there for next time.
+
+      if Cache_File /= null and then not From_Cache
+        and then Serious_Errors_Detected = 0
+      then
+         if Store_In_Cache (Output_File_Name (Output_Extension),
+                            Cache_File.all, Err_Msg'Address)
+         then
+            Error_Msg_N ("??could not save `" & Cache_File.all & "`: " &
+                           Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
+         end if;
+      end if;
+
+      Free (Cache_File);
+      Finalize_Optimization_Remarks (Module);
+
+      --  If requested, report the size of the object file we've written
+
+      if Size_Report and then Writing_Object and then Verified
+        and then Serious_Errors_Detected = 0
+      then
+         declare
+            Report_File : constant String :=
+              (if   Size_Report_File /= null then Size_Report_File.all
+               else Output_File_Name (".size"));
+
+         begin
+            if Write_Size_Report (Output_File_Name (".o"), Report_File,
+                                  Err_Msg'Address)
+            then
+               Error_Msg_N ("could not write `" & Report_File & "`: " &
+                              Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
+            end if;
+         end;
+      end if;
+
+      --  Report the time taken by what we've done, if requested
+
+      declare
+         Trace_File : constant String :=
+           (if   Time_Trace_File /= null then Time_Trace_File.all
+            else Output_File_Name (".json"));
+
+      begin
+         if Finalize_Timing (Trace_File, Err_Msg'Address) then
+            Error_Msg_N ("could not write `" & Trace_File & "`: " &
+                           Get_LLVM_Error_Msg (Err_Msg), GNAT_Root);
+         end if;
+      end;
+
       --  Release the environment
 
       if Emit_Debug_Info then
@@ -695,6 +1102,52 @@ package body GNATLLVM.Codegen is
         or else Switch = "-nostdlib" or else Switch = "-pipe";
    end Is_Back_End_Switch;
 
+   -----------------------
+   -- Cache_Key_Options --
+   -----------------------
+
+   function Cache_Key_Options return String is
+      function Affects_Output (Switch : String) return Boolean is
+        (Is_Back_End_Switch (Switch)
+         and then not Has_Prefix (Switch, "-fcache-dir=")
+         and then not Has_Prefix (Switch, "-fcodegen-jobs=")
+         and then not Has_Prefix (Switch, "-ftime-report")
+         and then not Has_Prefix (Switch, "-ftime-trace")
+         and then not Has_Prefix (Switch, "-fsize-report"));
+      --  Return True if Switch is a back-end switch that can change the
+      --  output of this compilation, as opposed to where we look for it
+      --  or what we report about the compilation.
+
+      function Switches_From (J : Positive) return String is
+        (if    J > Argument_Count then ""
+         elsif Affects_Output (Argument (J))
+         then  Argument (J) & ASCII.LF & Switches_From (J + 1)
+         else  Switches_From (J + 1));
+      --  Return the back-end switches starting with the Jth argument that
+      --  can change the output
+
+   begin
+      return Gnat_Version_String & ASCII.LF & Target_Triple.all & ASCII.LF &
+        CPU.all & ASCII.LF & Features.all & ASCII.LF &
+        Code_Generation_Kind'Image (Code_Generation) & ASCII.LF &
+        "-O" & Int'Image (Code_Opt_Level) & Int'Image (Size_Opt_Level) &
+        ASCII.LF & Switches_From (1);
+   end Cache_Key_Options;
+
+   ---------------------
+   -- Cache_Key_Files --
+   ---------------------
+
+   function Cache_Key_Files return String is
+     ((if   Profile_Use_File = null then ""
+       else Profile_Use_File.all & ASCII.LF) &
+      (if   Profile_Sample_Use_File = null then ""
+       else Profile_Sample_Use_File.all & ASCII.LF) &
+      (if   Pass_Plugin_Name = null then ""
+       else Pass_Plugin_Name.all & ASCII.LF) &
+      (if   Has_Prefix (Target_Triple.all, "nvptx64")
+       then Libdevice_Filename.all & ASCII.LF else ""));
+
    ----------------------
    -- Output_File_Name --
    ----------------------
@@ -45,6 +45,7 @@ with GNATLLVM.Types.Create; use GNATLLVM.Types.Create;
 with GNATLLVM.Subprograms;  use GNATLLVM.Subprograms;
 with GNATLLVM.Utils;        use GNATLLVM.Utils;
 with GNATLLVM.Variables;    use GNATLLVM.Variables;
+with GNATLLVM.Wrapper;      use GNATLLVM.Wrapper;
 
 with CCG; use CCG;
 
@@ -102,6 +103,11 @@ package body GNATLLVM.Compile is
          Initialize_LLVM_Target;
       end if;
 
+      --  The front end has finished its work, so we now start ours
+
+      Stop_Phase_Timer;
+      Start_Phase_Timer ("translation");
+
       --  If we're going to generate C code (or LLVM IR as if we were to
       --  generate C code), initialize that subsystem.
 
@@ -204,6 +210,7 @@ package body GNATLLVM.Compile is
       Output_Global_Constructors_Destructors;
       Add_Functions_To_Module;
       Finalize_Debugging;
+      Stop_Phase_Timer;
       Generate_Code (GNAT_Root);
       Namet.Lock;
 
@@ -675,6 +682,13 @@ package body GNATLLVM.Compile is
             Process_Freeze_Entity (N);
             Emit_Decl_Lists (Actions (N));
 
+            --  The actions of the freeze node of a tagged type build its
+            --  dispatch table, which we may need to mark.
+
+            if Is_Type (Entity (N)) and then Is_Tagged_Type (Entity (N)) then
+               Add_Dispatch_Table_Types (Entity (N));
+            end if;
+
          when N_Pragma =>
             Emit_Pragma (N);
 
@@ -1041,17 +1055,24 @@ package body GNATLLVM.Compile is
             end if;
 
          when N_Unchecked_Type_Conversion => Unchecked_Conversion : declare
-            Expr   : constant N_Subexpr_Id := Expression (N);
-            BT     : constant Type_Kind_Id := Full_Base_Type (GT);
+            Expr          : constant N_Subexpr_Id := Expression (N);
+            BT            : constant Type_Kind_Id := Full_Base_Type (GT);
+            Save_Suppress : constant Boolean      := Suppress_Range_Metadata;
 
          begin
-            --  The result can't have overflowed (this is unchecked), but
-            --  if this is not just converting between subtypes of the same
-            --  base type, it must be marked as aliasing everything.
-
+            --  The value of a scalar operand may be invalid (this is how
+            --  'Valid is expanded), so don't say that it's in the range
+            --  of its subtype. The result can't have overflowed (this is
+            --  unchecked), but if this is not just converting between
+            --  subtypes of the same base type, it must be marked as
+            --  aliasing everything.
+
+            Suppress_Range_Metadata :=
+              Save_Suppress or else Is_Scalar_Type (Full_Etype (Expr));
             Result := Emit_Conversion (Expr, GT, N,
                                        Is_Unchecked  => True,
                                        No_Truncation => No_Truncation (N));
+            Suppress_Range_Metadata := Save_Suppress;
             Clear_Overflowed (Result);
             if Full_Base_Type (Full_Etype (Expr)) /= BT then
                Set_Aliases_All (Result);
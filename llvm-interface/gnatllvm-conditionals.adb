@@ -27,6 +27,7 @@ with GNATLLVM.Conversions;  use GNATLLVM.Conversions;
 with GNATLLVM.Instructions; use GNATLLVM.Instructions;
 with GNATLLVM.Subprograms;  use GNATLLVM.Subprograms;
 with GNATLLVM.Utils;        use GNATLLVM.Utils;
+with GNATLLVM.Wrapper;      use GNATLLVM.Wrapper;
 
 package body GNATLLVM.Conditionals is
 
@@ -1403,6 +1404,10 @@ package body GNATLLVM.Conditionals is
       procedure Emit_Loop_Body;
       --  Emit the body of the loop
 
+      procedure Add_Hints_To_Latch;
+      --  Add any hints given by pragma Loop_Optimize to the branch that
+      --  we just built back to the start of the loop.
+
       Loop_Identifier : constant Opt_E_Loop_Id             :=
         (if Present (Identifier (N)) then Entity (Identifier (N)) else Empty);
       Iter_Scheme     : constant Opt_N_Iteration_Scheme_Id :=
@@ -1416,6 +1421,7 @@ package body GNATLLVM.Conditionals is
       BB_Start        : constant Basic_Block_T             :=
         (if   Is_For_Loop then Create_Basic_Block
          else Enter_Block_With_Node (Empty));
+      Hints           : Loop_Hints                         := No_Loop_Hints;
 
       --------------------
       -- Emit_Loop_Body --
@@ -1432,9 +1438,28 @@ package body GNATLLVM.Conditionals is
          Emit (Statements (N));
          Set_Debug_Pos_At_Node (N);
          Pop_Block;
+         Hints := Get_Loop_Hints;
          Pop_Loop;
       end Emit_Loop_Body;
 
+      ------------------------
+      -- Add_Hints_To_Latch --
+      ------------------------
+
+      procedure Add_Hints_To_Latch is
+         Latch : constant Value_T := Get_Last_Instruction (Get_Insert_Block);
+
+      begin
+         if Hints /= No_Loop_Hints and then Present (Latch) then
+            Add_Loop_Hints (Latch, BB_Start,
+                            Ivdep     => Hints (Hint_Ivdep),
+                            No_Unroll => Hints (Hint_No_Unroll),
+                            Unroll    => Hints (Hint_Unroll),
+                            No_Vector => Hints (Hint_No_Vector),
+                            Vector    => Hints (Hint_Vector));
+         end if;
+      end Add_Hints_To_Latch;
+
    begin
       --  Handle each case separarely. First we have the case of no
       --  iteration scheme, where the only ways to exit the loop are
@@ -1443,6 +1468,7 @@ package body GNATLLVM.Conditionals is
       if Is_Mere_Loop then
          Emit_Loop_Body;
          Build_Br (BB_Start);
+         Add_Hints_To_Latch;
 
       --  Next is the case where we have a condition, but not iteration
       --  variable. In that case, we start the loop with a test of that
@@ -1458,6 +1484,7 @@ package body GNATLLVM.Conditionals is
                Position_Builder_At_End (BB_Stmts);
                Emit_Loop_Body;
                Build_Br (BB_Start);
+               Add_Hints_To_Latch;
             end if;
          end;
 
@@ -1554,6 +1581,7 @@ package body GNATLLVM.Conditionals is
                Store ((if Reversed then Sub (Prev, One) else Add (Prev, One)),
                       Loop_Var);
                Build_Cond_Br (I_Cmp (Int_NE, Prev, Last), BB_Start, BB_Exit);
+               Add_Hints_To_Latch;
             end if;
          end;
       end if;
@@ -195,7 +195,9 @@ package body GNATLLVM.DebugInfo is
              else DWARF_Source_Language_Ada_95),
             Get_Debug_File_Node (Main_Source_File), "GNAT/LLVM",
             Code_Gen_Level /= Code_Gen_Level_None, "", 0, "",
-            DWARF_Emission_Full, 0, False, False, "", "");
+            (if   Debug_Locations_Only then DWARF_Emission_None
+             else DWARF_Emission_Full),
+            0, False, Debug_Info_For_Profiling, "", "");
 
          Empty_DI_Expr      :=
            DI_Builder_Create_Expression (DI_Builder, Exp'Access, 0);
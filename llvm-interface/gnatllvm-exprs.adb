@@ -1062,8 +1062,31 @@ package body GNATLLVM.Exprs is
                Next (Expr);
             end loop;
 
+         --  For pragma Loop_Optimize, record each hint for the enclosing
+         --  loop. They're added to the loop when we finish emitting it.
+
+         when Pragma_Loop_Optimize =>
+            Expr := First (PAAs);
+            while Present (Expr) loop
+               case Chars (Expression (Expr)) is
+                  when Name_Ivdep     =>
+                     Add_Loop_Hint (Hint_Ivdep);
+                  when Name_No_Unroll =>
+                     Add_Loop_Hint (Hint_No_Unroll);
+                  when Name_Unroll    =>
+                     Add_Loop_Hint (Hint_Unroll);
+                  when Name_No_Vector =>
+                     Add_Loop_Hint (Hint_No_Vector);
+                  when Name_Vector    =>
+                     Add_Loop_Hint (Hint_Vector);
+                  when others         =>
+                     null;
+               end case;
+
+               Next (Expr);
+            end loop;
+
          when Pragma_Inspection_Point
-            | Pragma_Loop_Optimize
             | Pragma_Warning_As_Error
             | Pragma_Warnings =>
             --  ??? These are the ones that Gigi supports and we may want
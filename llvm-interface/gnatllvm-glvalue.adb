@@ -1536,6 +1536,15 @@ package body GNATLLVM.GLValue is
       Set_Value_Name_2 (+V, Name, Name'Length);
    end Set_Value_Name;
 
+   ------------------------------
+   -- Add_Argmemonly_Attribute --
+   ------------------------------
+
+   procedure Add_Argmemonly_Attribute (V : GL_Value) is
+   begin
+      Add_Argmemonly_Attribute (+V);
+   end Add_Argmemonly_Attribute;
+
    ------------------------
    -- Add_Cold_Attribute --
    -----------------------
@@ -1697,6 +1706,15 @@ package body GNATLLVM.GLValue is
       Add_Nocapture_Attribute (+V, unsigned (Idx));
    end Add_Nocapture_Attribute;
 
+   --------------------------
+   -- Add_Nofree_Attribute --
+   --------------------------
+
+   procedure Add_Nofree_Attribute (V : GL_Value) is
+   begin
+      Add_Nofree_Attribute (+V);
+   end Add_Nofree_Attribute;
+
    ----------------------------
    -- Add_Non_Null_Attribute --
    ----------------------------
@@ -1715,6 +1733,15 @@ package body GNATLLVM.GLValue is
       Add_Non_Null_Attribute (+V);
    end Add_Non_Null_Attribute;
 
+   --------------------------
+   -- Add_Nosync_Attribute --
+   --------------------------
+
+   procedure Add_Nosync_Attribute (V : GL_Value) is
+   begin
+      Add_Nosync_Attribute (+V);
+   end Add_Nosync_Attribute;
+
    ----------------------------
    -- Add_Readonly_Attribute --
    ----------------------------
@@ -1733,6 +1760,15 @@ package body GNATLLVM.GLValue is
       Add_Readonly_Attribute (+V);
    end Add_Readonly_Attribute;
 
+   ----------------------------
+   -- Add_Readnone_Attribute --
+   ----------------------------
+
+   procedure Add_Readnone_Attribute (V : GL_Value) is
+   begin
+      Add_Readnone_Attribute (+V);
+   end Add_Readnone_Attribute;
+
    -----------------------------
    -- Add_Writeonly_Attribute --
    -----------------------------
@@ -1312,6 +1312,15 @@ package body GNATLLVM.Instructions is
 
       --  Build the result, with the proper GT and relationship
 
+      --  If we're loading a non-volatile scalar, say that it's in the
+      --  range of its subtype.
+
+      if Is_Data (New_R) and then not Special_Atomic
+        and then not Is_Volatile (Ptr)
+      then
+         Add_Range_To_Instruction (Load_Inst, Load_GT);
+      end if;
+
       Result := G (Load_Inst, Load_GT, New_R);
       Initialize_Alignment (Result);
       Initialize_TBAA      (Result);
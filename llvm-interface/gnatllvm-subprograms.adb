@@ -16,7 +16,9 @@
 ------------------------------------------------------------------------------
 
 with Einfo.Utils; use Einfo.Utils;
+with Elists;      use Elists;
 with Errout;      use Errout;
+with Exp_Disp;    use Exp_Disp;
 with Exp_Unst;    use Exp_Unst;
 with Exp_Util;    use Exp_Util;
 with Get_Targ;    use Get_Targ;
@@ -25,6 +27,7 @@ with Nlists;      use Nlists;
 with Restrict;    use Restrict;
 with Rident;      use Rident;
 with Sem_Aux;     use Sem_Aux;
+with Sem_Disp;    use Sem_Disp;
 with Sem_Mech;    use Sem_Mech;
 with Sem_Util;    use Sem_Util;
 with Sinput;      use Sinput;
@@ -233,6 +236,23 @@ package body GNATLLVM.Subprograms is
    function Is_Binder_Elab_Proc (Name : String) return Boolean;
    --  Return True if Name is the name of the elab proc for Ada_Main
 
+   function Has_Null_Global (E : Subprogram_Kind_Id) return Boolean;
+   --  Return True if E has a Global => null contract, meaning that it
+   --  neither reads nor writes any object other than its parameters.
+
+   function Dispatching_Type
+     (N : N_Subprogram_Call_Id) return Opt_Type_Kind_Id;
+   --  If N is the expansion of a dispatching call, return the tagged type
+   --  whose dispatch table it calls through, unless that's an interface or
+   --  N calls a predefined primitive.
+
+   function Type_Id (TE : Type_Kind_Id) return String;
+   --  Return the name identifying TE for whole-program devirtualization:
+   --  the external name of its dispatch table, which is unique even among
+   --  tagged types with the same name. Return "" if TE has no dispatch
+   --  table or is derived from a type declared in a predefined unit, since
+   --  the runtime extends such types without describing their tables.
+
    First_Body_Elab_Idx    : Nat                    := 0;
    --  Indicates the first entry in Elaborations that represents
    --  an elab entry for the body of a package.  If zero, then all entries
@@ -1335,6 +1355,21 @@ package body GNATLLVM.Subprograms is
                   or else Name (Name'Last - 11 .. Name'Last - 8) = "main");
    end Is_Binder_Elab_Proc;
 
+   ---------------------
+   -- Has_Null_Global --
+   ---------------------
+
+   function Has_Null_Global (E : Subprogram_Kind_Id) return Boolean is
+      Prag : constant Node_Id := Get_Pragma (E, Pragma_Global);
+
+   begin
+      return Present (Prag)
+        and then Present (Pragma_Argument_Associations (Prag))
+        and then Nkind (Expression
+                          (First (Pragma_Argument_Associations (Prag))))
+                   = N_Null;
+   end Has_Null_Global;
+
    -----------------------
    -- Get_Elab_Position --
    -----------------------
@@ -1942,6 +1977,97 @@ package body GNATLLVM.Subprograms is
 
    end Emit_Subprogram_Identifier;
 
+   ----------------------
+   -- Dispatching_Type --
+   ----------------------
+
+   function Dispatching_Type
+     (N : N_Subprogram_Call_Id) return Opt_Type_Kind_Id
+   is
+      Orig : constant Node_Id := Original_Node (N);
+      Typ  : Opt_Type_Kind_Id;
+
+   begin
+      --  The front end rewrites a dispatching call into an indirect call
+      --  through the dispatch table, but the original call is still
+      --  there and says which subprogram we're dispatching on. Calls to
+      --  predefined primitives, even overridden ones, go through the
+      --  separate table of predefined primitives instead, whose slots
+      --  don't correspond to those of the dispatch table.
+
+      if Nkind (Orig) not in N_Subprogram_Call
+        or else No (Controlling_Argument (Orig))
+        or else not Is_Entity_Name (Name (Orig))
+        or else Is_Predefined_Dispatching_Operation (Entity (Name (Orig)))
+        or else Is_Predefined_Dispatching_Alias (Entity (Name (Orig)))
+      then
+         return Empty;
+      end if;
+
+      Typ := Find_Dispatching_Type (Entity (Name (Orig)));
+      return (if   Present (Typ) and then not Is_Interface (Typ)
+              then Get_Fullest_View (Typ) else Empty);
+   end Dispatching_Type;
+
+   -------------
+   -- Type_Id --
+   -------------
+
+   function Type_Id (TE : Type_Kind_Id) return String is
+     (if   In_Predefined_Unit (Root_Type (TE))
+           or else No (Access_Disp_Table (TE))
+           or else Is_Empty_Elmt_List (Access_Disp_Table (TE))
+      then ""
+      else Get_Ext_Name (Node (First_Elmt (Access_Disp_Table (TE)))));
+
+   ------------------------------
+   -- Add_Dispatch_Table_Types --
+   ------------------------------
+
+   procedure Add_Dispatch_Table_Types (TE : Type_Kind_Id) is
+      Full_TE : constant Type_Kind_Id := Get_Fullest_View (TE);
+      T       : Type_Kind_Id          := Full_TE;
+      Next_T  : Type_Kind_Id;
+      Tag     : Value_T               := No_Value_T;
+
+   begin
+      --  We don't do this for interfaces, since their dispatch tables are
+      --  secondary tables of the types implementing them.
+
+      if not Whole_Program_Vtables or else Ekind (Full_TE) /= E_Record_Type
+        or else Is_Interface (Full_TE)
+      then
+         return;
+      end if;
+
+      --  Find the tag of TE if we've built its dispatch table. If we
+      --  haven't, or if the table isn't a constant, as for a type declared
+      --  in a subprogram, we still have to say so, since otherwise calls
+      --  through the tables of TE's ancestors could be devirtualized to a
+      --  subprogram that TE overrides.
+
+      if Has_Dispatch_Table (Full_TE) and then Type_Id (Full_TE) /= ""
+        and then Present (Get_Value (Node (First_Elmt
+                                             (Access_Disp_Table (Full_TE)))))
+      then
+         Tag := +Get_Value (Node (First_Elmt (Access_Disp_Table (Full_TE))));
+      end if;
+
+      --  A derived type's dispatch table starts with the subprograms of
+      --  its parent in the same order, so a call through the dispatch
+      --  table of any ancestor can be through this one.
+
+      loop
+         if Type_Id (T) /= "" then
+            Add_Dispatch_Table_Type (Module, Tag, Type_Id (T));
+         end if;
+
+         Next_T := Get_Fullest_View (Base_Type (Etype (T)));
+         exit when Next_T = T;
+         T := Next_T;
+      end loop;
+   end Add_Dispatch_Table_Types;
+
    ---------------
    -- Emit_Call --
    ---------------
@@ -2179,6 +2305,21 @@ package body GNATLLVM.Subprograms is
          LLVM_Func := Get (LLVM_Func, Reference);
       end if;
 
+      --  If this is a dispatching call and we're preparing for
+      --  whole-program devirtualization, say what type's dispatch table
+      --  we got the subprogram from.
+
+      if Whole_Program_Vtables and then not Direct_Call then
+         declare
+            Typ : constant Opt_Type_Kind_Id := Dispatching_Type (N);
+
+         begin
+            if Present (Typ) and then Type_Id (Typ) /= "" then
+               Add_Type_Test (+LLVM_Func, Type_Id (Typ));
+            end if;
+         end;
+      end if;
+
       --  Add a pointer to the location of the return value if the return
       --  type is of dynamic size.
 
@@ -2400,6 +2541,15 @@ package body GNATLLVM.Subprograms is
                Result := Call_Ref (LLVM_Func, Return_GT, Args);
             else
                Result := Call (LLVM_Func, Return_GT, Args);
+
+               --  If this is an Ada function, we can assume that the
+               --  value it returns is in the range of its subtype.
+
+               if not Foreign
+                 and then Present (Is_A_Instruction (+Result))
+               then
+                  Add_Range_To_Instruction (+Result, Return_GT);
+               end if;
             end if;
 
          when Out_Return =>
@@ -2584,6 +2734,26 @@ package body GNATLLVM.Subprograms is
       Param_Num   : Natural              := 0;
       Readonly    : Boolean              :=
           Pure_Func or else (Is_Pure (E) and then not Is_Imported);
+      Global_Null : constant Boolean     := Has_Null_Global (E);
+      Value_Ret   : constant Boolean     :=
+        Ekind (E) = E_Function and then RK = Value_Return
+          and then Is_Elementary_Type (Return_GT)
+          and then not Is_Access_Type (Return_GT)
+          and then not Is_Descendant_Of_Address (Return_GT);
+      --  True if E is a function whose result is a value that doesn't
+      --  designate memory and isn't returned in memory.
+
+      Only_Values : Boolean              := Value_Ret;
+      --  True if E is a function whose parameters and result are all
+      --  values that don't designate memory.
+
+      Argmem_Only : Boolean              :=
+        Global_Null and then (Ekind (E) /= E_Function or else Value_Ret);
+      --  True if the only memory that E can access is that designated
+      --  by its reference parameters. A function that allocates its
+      --  result, whether with an allocator or on the secondary stack,
+      --  accesses other memory even with Global => null.
+
       UID         : constant Unique_Id   := New_Unique_Id;
       Formal      : Opt_Formal_Kind_Id;
 
@@ -2683,6 +2853,28 @@ package body GNATLLVM.Subprograms is
                   Readonly := False;
                end if;
 
+               --  If this parameter is or contains something that
+               --  designates memory, E can access that memory too.
+
+               if PK = Activation_Record or else Is_Access_Type (GT)
+                 or else Is_Descendant_Of_Address (GT)
+               then
+                  Only_Values := False;
+                  Argmem_Only := False;
+               elsif PK_Is_Reference (PK) then
+                  Only_Values := False;
+                  if not Is_Elementary_Type (GT)
+                    and then (not Is_Array_Type (GT)
+                                or else Is_Unconstrained_Array (GT)
+                                or else not Is_Elementary_Type
+                                              (Full_Component_GL_Type (GT))
+                                or else Is_Access_Type
+                                          (Full_Component_GL_Type (GT)))
+                  then
+                     Argmem_Only := False;
+                  end if;
+               end if;
+
                --  Verify that the convention is valid and compute
                --  any parameter attributes.
 
@@ -2751,6 +2943,26 @@ package body GNATLLVM.Subprograms is
             end;
          end loop;
 
+         --  A function whose parameters and result are all values and
+         --  which is either in a Pure unit, has pragma Pure_Function, or
+         --  has a Global => null contract depends only on the values of
+         --  its parameters (see RM 10.2.1(18)), so we can say that it
+         --  doesn't access memory at all. Otherwise, if it has a Global
+         --  => null contract, the only memory it can access is that of
+         --  its reference parameters, as long as what they designate
+         --  doesn't itself contain pointers.
+
+         if Only_Values and then not No_Return (E)
+           and then (Readonly or else Global_Null)
+         then
+            Add_Readnone_Attribute (LLVM_Func);
+            Add_Nofree_Attribute   (LLVM_Func);
+            Add_Nosync_Attribute   (LLVM_Func);
+            Readonly := False;
+         elsif Argmem_Only and then not No_Return (E) then
+            Add_Argmemonly_Attribute (LLVM_Func);
+            Add_Nofree_Attribute     (LLVM_Func);
+         end if;
       end if;
 
       --  Save the value for this subprogram and possibly set it readonly
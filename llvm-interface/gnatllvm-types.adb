@@ -38,6 +38,7 @@ with GNATLLVM.Subprograms;  use GNATLLVM.Subprograms;
 with GNATLLVM.Types.Create; use GNATLLVM.Types.Create;
 with GNATLLVM.Utils;        use GNATLLVM.Utils;
 with GNATLLVM.Variables;    use GNATLLVM.Variables;
+with GNATLLVM.Wrapper;      use GNATLLVM.Wrapper;
 
 with CCG; use CCG;
 
@@ -95,6 +96,18 @@ package body GNATLLVM.Types is
    --  include the alignment of the bounds in some array cases.  It also
    --  may take into account the alignment of E, if present.
 
+   function Stack_Or_Heap_Alloca
+     (GT       : GL_Type;
+      Num_Elts : GL_Value;
+      E        : Entity_Id;
+      Align    : Nat;
+      Name     : String) return GL_Value
+     with Pre  => Present (GT) and then Present (Num_Elts),
+          Post => Is_Pointer (Stack_Or_Heap_Alloca'Result);
+   --  Like Array_Alloca, but if the size of the allocation is larger than
+   --  Heap_Allocation_Threshold, allocate the memory on the heap and
+   --  arrange for it to be freed when we leave the current block.
+
    function Move_Into_Memory
      (Temp     : GL_Value;
       V        : GL_Value;
@@ -603,6 +616,7 @@ package body GNATLLVM.Types is
       Value      : GL_Value         := V;
       Element_GT : GL_Type;
       Num_Elts   : GL_Value;
+      Use_Heap   : Boolean;
       Result     : GL_Value;
 
    begin
@@ -683,12 +697,22 @@ package body GNATLLVM.Types is
          Num_Elts := Build_Max (Num_Elts, Size_Const_Int (Uint_1));
       end if;
 
+      --  If we've been asked to put large objects whose size isn't known
+      --  until run time on the heap, see if we can do that here.
+
+      Use_Heap := Heap_Allocation_Threshold > 0 and then not Overalign
+        and then not Is_A_Constant_Int (Num_Elts)
+        and then Can_Free_At_Block_End;
+
       --  Check that we aren't trying to allocate too much memory.  Raise
       --  Storage_Error if so.  We don't try to support local exception
       --  labels and -fstack-check at the same time.  The divide below
       --  will constant-fold, but make sure we aren't dividing by zero.
+      --  If a large object will go on the heap, the allocator checks.
 
-      if Do_Stack_Check and then not Is_Zero_Size (Element_GT) then
+      if Do_Stack_Check and then not Use_Heap
+        and then not Is_Zero_Size (Element_GT)
+      then
 
          --  If everything is constant, we may know that we unconditionally
          --  overflow.
@@ -734,11 +758,18 @@ package body GNATLLVM.Types is
          return Get_Undef_Ref (GT);
       end if;
 
-      --  Otherwise allocate the object, align if necessary, and then move
-      --  any data into it.
+      --  Otherwise allocate the object, either on the stack or the heap as
+      --  determined above, align if necessary, and then move any data into
+      --  it.
+
+      if Use_Heap then
+         Result := Stack_Or_Heap_Alloca (Element_GT, Num_Elts, E, Align,
+                                         Name);
+      else
+         Result := Array_Alloca (Element_GT, Num_Elts, E, Align,
+                                 (if Overalign then "%%" else Name));
+      end if;
 
-      Result := Array_Alloca (Element_GT, Num_Elts, E, Align,
-                              (if Overalign then "%%" else Name));
       if Overalign then
          Result := Ptr_To_Int (Result, Size_GL_Type);
          Result := Align_To   (Result, Get_Stack_Alignment, To_Bytes (Align));
@@ -750,6 +781,57 @@ package body GNATLLVM.Types is
 
    end Allocate_For_Type;
 
+   --------------------------
+   -- Stack_Or_Heap_Alloca --
+   --------------------------
+
+   function Stack_Or_Heap_Alloca
+     (GT       : GL_Type;
+      Num_Elts : GL_Value;
+      E        : Entity_Id;
+      Align    : Nat;
+      Name     : String) return GL_Value
+   is
+      Size     : constant GL_Value      :=
+        Num_Elts * To_Bytes (Get_Type_Size (GT));
+      BB_Heap  : constant Basic_Block_T := Create_Basic_Block ("HEAP");
+      BB_Stack : constant Basic_Block_T := Create_Basic_Block ("STACK");
+      BB_Next  : constant Basic_Block_T := Create_Basic_Block;
+      Stack_V  : GL_Value;
+      Heap_V   : GL_Value;
+      Heap_BB  : Basic_Block_T;
+      Stack_BB : Basic_Block_T;
+      Result   : GL_Value;
+
+   begin
+      --  Test the size and allocate the memory in the appropriate place.
+      --  Note that making the call may have changed the basic block.
+
+      Build_Cond_Br (I_Cmp (Int_UGT, Size,
+                            Size_Const_Int (ULL (Heap_Allocation_Threshold))),
+                     BB_Heap, BB_Stack);
+      Position_Builder_At_End (BB_Stack);
+      Stack_V  := Array_Alloca (GT, Num_Elts, E, Align, Name);
+      Stack_BB := Get_Insert_Block;
+      Build_Br (BB_Next);
+      Position_Builder_At_End (BB_Heap);
+      Heap_V   := Call (Get_Default_Alloc_Fn, A_Char_GL_Type, (1 => Size));
+      Heap_BB  := Get_Insert_Block;
+      Result   := Pointer_Cast (Heap_V, Stack_V);
+      Build_Br (BB_Next);
+
+      --  Now merge the two and record the memory to be freed, which is
+      --  null if we allocated it on the stack.
+
+      Position_Builder_At_End (BB_Next);
+      Result := Build_Phi ((1 => Stack_V, 2 => Result),
+                           (1 => Stack_BB, 2 => Heap_BB));
+      Add_Heap_Entry (Build_Phi ((1 => Const_Null (A_Char_GL_Type),
+                                  2 => Heap_V),
+                                 (1 => Stack_BB, 2 => Heap_BB)));
+      return Result;
+   end Stack_Or_Heap_Alloca;
+
    ----------------------------
    -- Heap_Allocate_For_Type --
    ----------------------------
@@ -1555,6 +1637,41 @@ package body GNATLLVM.Types is
 
    end Add_Flags_To_Instruction;
 
+   ------------------------------
+   -- Add_Range_To_Instruction --
+   ------------------------------
+
+   procedure Add_Range_To_Instruction (Inst : Value_T; GT : GL_Type) is
+      LB, HB : Uint;
+
+   begin
+      --  We can only do this if the value is represented in the natural
+      --  way for its type. Skip enumeration types with a representation
+      --  clause since 'Valid for them works on the value, not on the
+      --  result of an unchecked conversion.
+
+      if not Range_Metadata or else Suppress_Range_Metadata or else Emit_C
+        or else not Is_Discrete_Type (GT)
+        or else not Is_Primitive_GL_Type (GT)
+        or else (Is_Enumeration_Type (Full_Etype (GT))
+                 and then Has_Enumeration_Rep_Clause (Full_Base_Type (GT)))
+      then
+         return;
+      end if;
+
+      LB := Get_Uint_Value (Type_Low_Bound (GT));
+      HB := Get_Uint_Value (Type_High_Bound (GT));
+      if Present (LB) and then Present (HB) and then LB <= HB then
+         declare
+            Low  : constant GL_Value := Const_Int (GT, LB);
+            High : constant GL_Value := Const_Int (GT, HB);
+
+         begin
+            Add_Range_Metadata (Inst, +Low, +High);
+         end;
+      end if;
+   end Add_Range_To_Instruction;
+
    ------------------------------
    -- Check_OK_For_Atomic_Type --
    ------------------------------
@@ -494,20 +494,29 @@ package body GNATLLVM.Utils is
             P     : constant Opt_N_Pragma_Id := Linker_Section_Pragma (E);
             List  : constant List_Id         :=
               Pragma_Argument_Associations (P);
-            Str   : constant N_Subexpr_Id    := Expression (Last (List));
-            S_Id  : constant String_Id       := Strval (Expr_Value_S (Str));
-            S     : String (1 .. Integer (String_Length (S_Id)));
 
          begin
-            for J in S'Range loop
-               S (J) := Get_Character (Get_String_Char (S_Id, Nat (J)));
-            end loop;
-
-            Set_Section (V, S);
+            Set_Section (V, Static_String_Value (Expression (Last (List))));
          end;
       end if;
    end Set_Linker_Section;
 
+   -------------------------
+   -- Static_String_Value --
+   -------------------------
+
+   function Static_String_Value (N : N_Subexpr_Id) return String is
+      S_Id : constant String_Id := Strval (Expr_Value_S (N));
+      S    : String (1 .. Integer (String_Length (S_Id)));
+
+   begin
+      for J in S'Range loop
+         S (J) := Get_Character (Get_String_Char (S_Id, Nat (J)));
+      end loop;
+
+      return S;
+   end Static_String_Value;
+
    ---------------------
    -- Process_Pragmas --
    ---------------------
@@ -522,6 +531,40 @@ package body GNATLLVM.Utils is
          Set_Linkage (V, External_Weak_Linkage);
       end if;
 
+      --  There may be more than one pragma Machine_Attribute, so we do
+      --  have to walk the list of representation items to find them. The
+      --  only one we support is target_clones, for subprograms, which we
+      --  record as an attribute of the function and expand once we've
+      --  compiled the unit.
+
+      declare
+         Item : Node_Id := First_Rep_Item (E);
+
+      begin
+         while Present (Item) loop
+            if Nkind (Item) = N_Pragma
+              and then Get_Pragma_Id (Item) = Pragma_Machine_Attribute
+            then
+               declare
+                  Name_Arg  : constant Node_Id :=
+                    Next (First (Pragma_Argument_Associations (Item)));
+                  Value_Arg : constant Node_Id := Next (Name_Arg);
+
+               begin
+                  if Is_A_Function (V) and then Present (Value_Arg)
+                    and then Static_String_Value (Expression (Name_Arg)) =
+                               "target_clones"
+                  then
+                     Add_Named_Attribute
+                       (V, "target-clones",
+                        Static_String_Value (Expression (Value_Arg)));
+                  end if;
+               end;
+            end if;
+
+            Item := Next_Rep_Item (Item);
+         end loop;
+      end;
    end Process_Pragmas;
 
    --------------------------------
@@ -78,6 +78,52 @@ package body GNATLLVM.Wrapper is
                                              Offsets, Sizes);
    end Create_TBAA_Struct_Type_Node;
 
+   -----------------------------
+   -- Add_Dispatch_Table_Type --
+   -----------------------------
+
+   procedure Add_Dispatch_Table_Type
+     (Module : Module_T; Tag : Value_T; Type_Id : String)
+   is
+      procedure Add_Dispatch_Table_Type_C
+        (Module : Module_T; Tag : Value_T; Type_Id : String)
+        with Import, Convention => C,
+             External_Name => "Add_Dispatch_Table_Type";
+   begin
+      Add_Dispatch_Table_Type_C (Module, Tag, Type_Id & ASCII.NUL);
+   end Add_Dispatch_Table_Type;
+
+   -------------------
+   -- Add_Type_Test --
+   -------------------
+
+   procedure Add_Type_Test (Callee : Value_T; Type_Id : String) is
+      procedure Add_Type_Test_C (Callee : Value_T; Type_Id : String)
+        with Import, Convention => C, External_Name => "Add_Type_Test";
+   begin
+      Add_Type_Test_C (Callee, Type_Id & ASCII.NUL);
+   end Add_Type_Test;
+
+   --------------------
+   -- Add_Loop_Hints --
+   --------------------
+
+   procedure Add_Loop_Hints
+     (Latch                                      : Value_T;
+      Header                                     : Basic_Block_T;
+      Ivdep, No_Unroll, Unroll, No_Vector, Vector : Boolean)
+   is
+      procedure Add_Loop_Hints_C
+        (Latch                                      : Value_T;
+         Header                                     : Basic_Block_T;
+         Ivdep, No_Unroll, Unroll, No_Vector, Vector : LLVM_Bool)
+        with Import, Convention => C, External_Name => "Add_Loop_Hints";
+   begin
+      Add_Loop_Hints_C (Latch, Header, Boolean'Pos (Ivdep),
+                        Boolean'Pos (No_Unroll), Boolean'Pos (Unroll),
+                        Boolean'Pos (No_Vector), Boolean'Pos (Vector));
+   end Add_Loop_Hints;
+
    ------------------------
    -- Build_Extract_Value --
    ------------------------
@@ -338,6 +384,15 @@ package body GNATLLVM.Wrapper is
       Prepare_For_LTO       : Boolean;
       Reroll_Loops          : Boolean;
       Pass_Plugin_Name      : String_Access;
+      Profile_Gen_File      : String_Access;
+      Profile_Use_File      : String_Access;
+      Sample_Use_File       : String_Access;
+      Debug_Info_For_Prof   : Boolean;
+      Vector_Library        : Nat;
+      No_Builtins           : Boolean;
+      No_Builtin_Functions  : String_Access;
+      No_Check_Versioning   : Boolean;
+      No_Hot_Cold_Split     : Boolean;
       Error_Message         : System.Address) return Boolean
    is
       function LLVM_Optimize_Module_C
@@ -354,6 +409,15 @@ package body GNATLLVM.Wrapper is
          PrepareFor_LTO        : LLVM_Bool;
          Reroll_Loops          : LLVM_Bool;
          Pass_Plugin_Name      : chars_ptr;
+         Profile_Gen_File      : chars_ptr;
+         Profile_Use_File      : chars_ptr;
+         Sample_Use_File       : chars_ptr;
+         Debug_Info_For_Prof   : LLVM_Bool;
+         Vector_Library        : Nat;
+         No_Builtins           : LLVM_Bool;
+         No_Builtin_Functions  : chars_ptr;
+         No_Check_Versioning   : LLVM_Bool;
+         No_Hot_Cold_Split     : LLVM_Bool;
          Error_Message         : System.Address) return LLVM_Bool
         with Import, Convention => C, External_Name => "LLVM_Optimize_Module";
       Need_Loop_Info_B : constant LLVM_Bool := Boolean'Pos (Need_Loop_Info);
@@ -372,6 +436,32 @@ package body GNATLLVM.Wrapper is
             Null_Ptr
          else
             New_String (Pass_Plugin_Name.all));
+      Prof_Gen_Ptr     : chars_ptr :=
+        (if Profile_Gen_File = null then
+            Null_Ptr
+         else
+            New_String (Profile_Gen_File.all));
+      Prof_Use_Ptr     : chars_ptr :=
+        (if Profile_Use_File = null then
+            Null_Ptr
+         else
+            New_String (Profile_Use_File.all));
+      Sample_Use_Ptr   : chars_ptr :=
+        (if Sample_Use_File = null then
+            Null_Ptr
+         else
+            New_String (Sample_Use_File.all));
+      DI_For_Prof_B    : constant LLVM_Bool :=
+        Boolean'Pos (Debug_Info_For_Prof);
+      No_Builtins_B    : constant LLVM_Bool := Boolean'Pos (No_Builtins);
+      No_Builtin_Ptr   : chars_ptr :=
+        (if No_Builtin_Functions = null then
+            Null_Ptr
+         else
+            New_String (No_Builtin_Functions.all));
+      No_Check_Vers_B  : constant LLVM_Bool :=
+        Boolean'Pos (No_Check_Versioning);
+      No_HC_Split_B    : constant LLVM_Bool := Boolean'Pos (No_Hot_Cold_Split);
       Result           : LLVM_Bool;
 
    begin
@@ -380,11 +470,258 @@ package body GNATLLVM.Wrapper is
                                 Code_Opt_Level, Size_Opt_Level,
                                 Need_Loop_Info_B, No_Unroll_B, No_Loop_Vect_B,
                                 No_SLP_Vect_B, Merge_B, Thin_LTO_B, LTO_B,
-                                Reroll_B, Pass_PN_Ptr, Error_Message);
+                                Reroll_B, Pass_PN_Ptr, Prof_Gen_Ptr,
+                                Prof_Use_Ptr, Sample_Use_Ptr, DI_For_Prof_B,
+                                Vector_Library, No_Builtins_B, No_Builtin_Ptr,
+                                No_Check_Vers_B, No_HC_Split_B,
+                                Error_Message);
       Free (Pass_PN_Ptr);
+      Free (Prof_Gen_Ptr);
+      Free (Prof_Use_Ptr);
+      Free (Sample_Use_Ptr);
+      Free (No_Builtin_Ptr);
       return Result /= 0;
    end LLVM_Optimize_Module;
 
+   ---------------------
+   -- Initialize_LLVM --
+   ---------------------
+
+   procedure Initialize_LLVM (Target_Triple : String) is
+      procedure Initialize_LLVM_C (Target_Triple : String)
+        with Import, Convention => C, External_Name => "Initialize_LLVM";
+   begin
+      Initialize_LLVM_C (Target_Triple & ASCII.NUL);
+   end Initialize_LLVM;
+
+   -----------------------
+   -- Initialize_Timing --
+   -----------------------
+
+   procedure Initialize_Timing
+     (Time_Report : Boolean; Time_Trace : Boolean; Granularity : Nat)
+   is
+      procedure Initialize_Timing_C
+        (Time_Report : LLVM_Bool; Time_Trace : LLVM_Bool; Granularity : Nat)
+        with Import, Convention => C, External_Name => "Initialize_Timing";
+   begin
+      Initialize_Timing_C (Boolean'Pos (Time_Report), Boolean'Pos (Time_Trace),
+                           Granularity);
+   end Initialize_Timing;
+
+   -----------------------
+   -- Start_Phase_Timer --
+   -----------------------
+
+   procedure Start_Phase_Timer (Name : String) is
+      procedure Start_Phase_Timer_C (Name : String)
+        with Import, Convention => C, External_Name => "Start_Phase_Timer";
+   begin
+      Start_Phase_Timer_C (Name & ASCII.NUL);
+   end Start_Phase_Timer;
+
+   ---------------------
+   -- Finalize_Timing --
+   ---------------------
+
+   function Finalize_Timing
+     (Trace_File : String; Error_Message : System.Address) return Boolean
+   is
+      function Finalize_Timing_C
+        (Trace_File : String; Error_Message : System.Address) return LLVM_Bool
+        with Import, Convention => C, External_Name => "Finalize_Timing";
+   begin
+      return Finalize_Timing_C (Trace_File & ASCII.NUL, Error_Message) /= 0;
+   end Finalize_Timing;
+
+   -------------------------------------
+   -- Initialize_Optimization_Remarks --
+   -------------------------------------
+
+   function Initialize_Optimization_Remarks
+     (Module        : Module_T;
+      Filename      : String;
+      Passes        : String_Access;
+      Format        : String;
+      With_Hotness  : Boolean;
+      Error_Message : System.Address) return Boolean
+   is
+      function Initialize_Optimization_Remarks_C
+        (Module        : Module_T;
+         Filename      : String;
+         Passes        : chars_ptr;
+         Format        : String;
+         With_Hotness  : LLVM_Bool;
+         Error_Message : System.Address) return LLVM_Bool
+        with Import, Convention => C,
+             External_Name => "Initialize_Optimization_Remarks";
+      Passes_Ptr : chars_ptr :=
+        (if Passes = null then Null_Ptr else New_String (Passes.all));
+      Result     : LLVM_Bool;
+
+   begin
+      Result :=
+        Initialize_Optimization_Remarks_C
+          (Module, Filename & ASCII.NUL, Passes_Ptr, Format & ASCII.NUL,
+           Boolean'Pos (With_Hotness), Error_Message);
+      Free (Passes_Ptr);
+      return Result /= 0;
+   end Initialize_Optimization_Remarks;
+
+   ---------------------------
+   -- Emit_To_File_Buffered --
+   ---------------------------
+
+   function Emit_To_File_Buffered
+     (Module        : Module_T;
+      TM            : Target_Machine_T;
+      Filename      : String;
+      Kind          : Code_Gen_File_Type_T;
+      Error_Message : System.Address) return Boolean
+   is
+      function Emit_To_File_Buffered_C
+        (Module        : Module_T;
+         TM            : Target_Machine_T;
+         Filename      : String;
+         Kind          : Code_Gen_File_Type_T;
+         Error_Message : System.Address) return LLVM_Bool
+        with Import, Convention => C,
+             External_Name => "Emit_To_File_Buffered";
+   begin
+      return Emit_To_File_Buffered_C (Module, TM, Filename & ASCII.NUL, Kind,
+                                      Error_Message) /= 0;
+   end Emit_To_File_Buffered;
+
+   -----------------------------
+   -- Emit_Object_In_Parallel --
+   -----------------------------
+
+   function Emit_Object_In_Parallel
+     (Module        : Module_T;
+      TM            : Target_Machine_T;
+      Jobs          : Nat;
+      Filename      : String;
+      Error_Message : System.Address) return Boolean
+   is
+      function Emit_Object_In_Parallel_C
+        (Module        : Module_T;
+         TM            : Target_Machine_T;
+         Jobs          : Nat;
+         Filename      : String;
+         Error_Message : System.Address) return LLVM_Bool
+        with Import, Convention => C,
+             External_Name => "Emit_Object_In_Parallel";
+   begin
+      return Emit_Object_In_Parallel_C (Module, TM, Jobs, Filename & ASCII.NUL,
+                                        Error_Message) /= 0;
+   end Emit_Object_In_Parallel;
+
+   --------------------------
+   -- Expand_Target_Clones --
+   --------------------------
+
+   function Expand_Target_Clones
+     (Module        : Module_T;
+      Features      : String;
+      Error_Message : System.Address) return Boolean
+   is
+      function Expand_Target_Clones_C
+        (Module        : Module_T;
+         Features      : String;
+         Error_Message : System.Address) return LLVM_Bool
+        with Import, Convention => C, External_Name => "Expand_Target_Clones";
+   begin
+      return Expand_Target_Clones_C (Module, Features & ASCII.NUL,
+                                     Error_Message) /= 0;
+   end Expand_Target_Clones;
+
+   -----------------------
+   -- Write_Size_Report --
+   -----------------------
+
+   function Write_Size_Report
+     (Object_File   : String;
+      Report_File   : String;
+      Error_Message : System.Address) return Boolean
+   is
+      function Write_Size_Report_C
+        (Object_File   : String;
+         Report_File   : String;
+         Error_Message : System.Address) return LLVM_Bool
+        with Import, Convention => C, External_Name => "Write_Size_Report";
+   begin
+      return Write_Size_Report_C (Object_File & ASCII.NUL,
+                                  Report_File & ASCII.NUL,
+                                  Error_Message) /= 0;
+   end Write_Size_Report;
+
+   --------------------
+   -- Link_Libdevice --
+   --------------------
+
+   function Link_Libdevice
+     (Module        : Module_T;
+      Filename      : String;
+      Error_Message : System.Address) return Boolean
+   is
+      function Link_Libdevice_C
+        (Module        : Module_T;
+         Filename      : String;
+         Error_Message : System.Address) return LLVM_Bool
+        with Import, Convention => C, External_Name => "Link_Libdevice";
+   begin
+      return Link_Libdevice_C (Module, Filename & ASCII.NUL,
+                               Error_Message) /= 0;
+   end Link_Libdevice;
+
+   --------------------------
+   -- Get_Module_Cache_Key --
+   --------------------------
+
+   function Get_Module_Cache_Key
+     (Module : Module_T; Options, Files : String) return String
+   is
+      procedure Get_Module_Cache_Key_C
+        (Module : Module_T; Options, Files : String; Key : out String)
+        with Import, Convention => C, External_Name => "Get_Module_Cache_Key";
+      Key : String (1 .. 40);
+
+   begin
+      Get_Module_Cache_Key_C (Module, Options & ASCII.NUL, Files & ASCII.NUL,
+                              Key);
+      return Key;
+   end Get_Module_Cache_Key;
+
+   ---------------------
+   -- Copy_From_Cache --
+   ---------------------
+
+   function Copy_From_Cache (Cache_File, Filename : String) return Boolean is
+      function Copy_From_Cache_C
+        (Cache_File, Filename : String) return LLVM_Bool
+        with Import, Convention => C, External_Name => "Copy_From_Cache";
+   begin
+      return Copy_From_Cache_C (Cache_File & ASCII.NUL,
+                                Filename & ASCII.NUL) /= 0;
+   end Copy_From_Cache;
+
+   --------------------
+   -- Store_In_Cache --
+   --------------------
+
+   function Store_In_Cache
+     (Filename, Cache_File : String; Error_Message : System.Address)
+     return Boolean
+   is
+      function Store_In_Cache_C
+        (Filename, Cache_File : String; Error_Message : System.Address)
+        return LLVM_Bool
+        with Import, Convention => C, External_Name => "Store_In_Cache";
+   begin
+      return Store_In_Cache_C (Filename & ASCII.NUL, Cache_File & ASCII.NUL,
+                               Error_Message) /= 0;
+   end Store_In_Cache;
+
    -----------------------------
    -- Get_GEP_Constant_Offset --
    -----------------------------
@@ -535,4 +872,16 @@ package body GNATLLVM.Wrapper is
       return Is_Dead_Basic_Block (BB) /= 0;
    end Is_Dead_Basic_Block;
 
+   --------------------
+   -- Is_Loop_Header --
+   --------------------
+
+   function Is_Loop_Header (BB : Basic_Block_T) return Boolean is
+      function Is_Loop_Header (BB : Basic_Block_T) return LLVM_Bool
+        with Import, Convention => C, External_Name => "Is_Loop_Header";
+
+   begin
+      return Is_Loop_Header (BB) /= 0;
+   end Is_Loop_Header;
+
 end GNATLLVM.Wrapper;
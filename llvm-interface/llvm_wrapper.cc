@@ -1,9 +1,18 @@
 #include "llvm-c/Types.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/VectorUtils.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -12,28 +21,53 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMRemarkStreamer.h"
+#include "llvm/Remarks/RemarkStreamer.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Object/ObjectFile.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
+#include "llvm/Passes/StandardInstrumentations.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/X86TargetParser.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include "llvm/Transforms/Scalar/InductiveRangeCheckElimination.h"
 #include "llvm/Transforms/Scalar/LoopPassManager.h"
 #include "llvm/Transforms/Scalar/LoopRotation.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
 #include "llvm-c/Core.h"
+#include "llvm-c/TargetMachine.h"
 
 using namespace llvm;
 using namespace llvm::sys;
@@ -87,8 +121,8 @@ extern "C"
 void
 Add_Ret_Dereferenceable_Attribute (Function *fn, unsigned long long Bytes)
 {
-  /* There doesn't appear to be a way to do this in LLVM 14, so skip for now.
-     fn->addDereferenceableRetAttr (Bytes); */
+  fn->addRetAttr (Attribute::getWithDereferenceableBytes (fn->getContext (),
+							 Bytes));
 }
 
 extern "C"
@@ -104,8 +138,8 @@ void
 Add_Ret_Dereferenceable_Or_Null_Attribute (Function *fn, 
 					   unsigned long long Bytes)
 {
-  /* There doesn't appear to be a way to do this in LLVM 14, so skip for now.
-     fn->addDereferenceableOrNullRetAttr (Bytes); */
+  fn->addRetAttr (Attribute::getWithDereferenceableOrNullBytes
+		  (fn->getContext (), Bytes));
 }
 
 extern "C"
@@ -136,6 +170,34 @@ Add_Fn_Readonly_Attribute (Function *fn)
   fn->addFnAttr (Attribute::ReadOnly);
 }
 
+extern "C"
+void
+Add_Fn_Readnone_Attribute (Function *fn)
+{
+  fn->addFnAttr (Attribute::ReadNone);
+}
+
+extern "C"
+void
+Add_Argmemonly_Attribute (Function *fn)
+{
+  fn->addFnAttr (Attribute::ArgMemOnly);
+}
+
+extern "C"
+void
+Add_Nofree_Attribute (Function *fn)
+{
+  fn->addFnAttr (Attribute::NoFree);
+}
+
+extern "C"
+void
+Add_Nosync_Attribute (Function *fn)
+{
+  fn->addFnAttr (Attribute::NoSync);
+}
+
 extern "C"
 void
 Add_Named_Attribute (Function *fn, const char *name, const char *val,
@@ -333,6 +395,240 @@ Add_TBAA_Access (Instruction *inst, MDNode *md)
   inst->setMetadata (LLVMContext::MD_tbaa, md);
 }
 
+/* Add to Latch, the branch back to Header at the end of a loop, the
+   llvm.loop metadata corresponding to the hints given by pragma
+   Loop_Optimize.  For Ivdep, which says that there are no dependencies
+   between iterations of the loop, we put every memory access in the loop
+   into an access group and say that accesses in that group can be done
+   in parallel.  */
+
+extern "C"
+void
+Add_Loop_Hints (Instruction *Latch, BasicBlock *Header, bool Ivdep,
+		bool NoUnroll, bool Unroll, bool NoVector, bool Vector)
+{
+  auto *BI = dyn_cast_or_null<BranchInst> (Latch);
+  if (!BI || !is_contained (successors (BI), Header))
+    return;
+
+  LLVMContext &Ctx = BI->getContext ();
+  SmallVector<Metadata *, 4> Args;
+  auto Temp = MDNode::getTemporary (Ctx, None);
+  auto Flag = [&] (const char *Name) {
+    Args.push_back (MDNode::get (Ctx, MDString::get (Ctx, Name)));
+  };
+  auto Bool = [&] (const char *Name, bool Val) {
+    Args.push_back
+      (MDNode::get (Ctx,
+		    {MDString::get (Ctx, Name),
+		     ConstantAsMetadata::get
+		       (ConstantInt::get (Type::getInt1Ty (Ctx), Val))}));
+  };
+
+  Args.push_back (Temp.get ());
+  if (Vector)
+    Bool ("llvm.loop.vectorize.enable", true);
+  else if (NoVector)
+    Bool ("llvm.loop.vectorize.enable", false);
+
+  if (Unroll)
+    Flag ("llvm.loop.unroll.enable");
+  else if (NoUnroll)
+    Flag ("llvm.loop.unroll.disable");
+
+  if (Ivdep)
+    {
+      /* The blocks of the loop are Header and those from which we can
+	 reach the latch without going through Header.  */
+      MDNode *AccessGroup = MDNode::getDistinct (Ctx, None);
+      SmallPtrSet<BasicBlock *, 16> Body;
+      SmallVector<BasicBlock *, 16> Worklist;
+
+      Body.insert (Header);
+      Worklist.push_back (BI->getParent ());
+      while (!Worklist.empty ())
+	{
+	  BasicBlock *BB = Worklist.pop_back_val ();
+	  if (Body.insert (BB).second)
+	    append_range (Worklist, predecessors (BB));
+	}
+
+      for (BasicBlock *BB : Body)
+	for (Instruction &I : *BB)
+	  if (I.mayReadOrWriteMemory ())
+	    I.setMetadata (LLVMContext::MD_access_group,
+			   uniteAccessGroups
+			     (I.getMetadata (LLVMContext::MD_access_group),
+			      AccessGroup));
+
+      Args.push_back (MDNode::get (Ctx,
+				   {MDString::get
+				      (Ctx, "llvm.loop.parallel_accesses"),
+				    AccessGroup}));
+    }
+
+  if (Args.size () == 1)
+    return;
+
+  MDNode *LoopID = MDNode::getDistinct (Ctx, Args);
+  LoopID->replaceOperandWith (0, LoopID);
+  BI->setMetadata (LLVMContext::MD_loop, LoopID);
+}
+
+/* Say that the value produced by Inst, a load or call, is between Low and
+   High, inclusive.  Do nothing if that's every value of its type.  */
+
+extern "C"
+void
+Add_Range_Metadata (Instruction *Inst, ConstantInt *Low, ConstantInt *High)
+{
+  APInt Lo = Low->getValue (), Hi = High->getValue () + 1;
+
+  if (Inst->getType () != Low->getType () || Lo == Hi)
+    return;
+
+  MDBuilder MDHelper (Inst->getContext ());
+  Inst->setMetadata (LLVMContext::MD_range, MDHelper.createRange (Lo, Hi));
+}
+
+/* Say that the type whose identifier is TypeId has a dispatch table that
+   we can't describe, such as one built on the stack for a type declared
+   in a subprogram.  We do that by giving the type to a writable variable
+   with public visibility, for which whole-program devirtualization will
+   refuse to analyze calls through any table of that type.  */
+
+static void
+Add_Unknown_Dispatch_Table (Module *M, const char *TypeId)
+{
+  const char *Name = "__gnat_unknown_dispatch_table";
+  GlobalVariable *GV = M->getNamedGlobal (Name);
+
+  if (!GV)
+    {
+      Type *Ty = Type::getInt8PtrTy (M->getContext ());
+      GV = new GlobalVariable (*M, Ty, false, GlobalValue::InternalLinkage,
+			       Constant::getNullValue (Ty), Name);
+      appendToUsed (*M, {GV});
+    }
+
+  GV->addTypeMetadata (0, MDString::get (M->getContext (), TypeId));
+}
+
+/* Tag, if nonnull, is the tag of a tagged type, which points into its
+   dispatch table, or a constant variable containing that tag.  Say that
+   the dispatch table, at the address the tag points to, is compatible
+   with the type whose identifier is TypeId, for whole-program
+   devirtualization.  If there's no tag or it isn't the address of a
+   constant table, say that the type has a table we can't describe.  */
+
+extern "C"
+void
+Add_Dispatch_Table_Type (Module *M, Value *Tag, const char *TypeId)
+{
+  const DataLayout &DL = M->getDataLayout ();
+  Value *V = Tag;
+  int64_t Offset = 0;
+
+  if (!V)
+    {
+      Add_Unknown_Dispatch_Table (M, TypeId);
+      return;
+    }
+
+  if (auto *GV = dyn_cast<GlobalVariable> (V))
+    if (GV->isConstant () && GV->hasDefinitiveInitializer ()
+	&& GV->getValueType ()->isPointerTy ())
+      V = GV->getInitializer ();
+
+  /* Look through the conversions and address arithmetic in the
+     initializer of the tag to find the dispatch table and the offset of
+     the tag within it.  */
+  while (V)
+    {
+      auto *CE = dyn_cast<ConstantExpr> (V);
+      if (!CE)
+	break;
+      else if (CE->isCast ())
+	V = CE->getOperand (0);
+      else if (CE->getOpcode () == Instruction::Add
+	       && isa<ConstantInt> (CE->getOperand (1)))
+	{
+	  Offset += cast<ConstantInt> (CE->getOperand (1))->getSExtValue ();
+	  V = CE->getOperand (0);
+	}
+      else if (auto *GEP = dyn_cast<GEPOperator> (CE))
+	{
+	  APInt GEPOffset (DL.getIndexTypeSizeInBits (GEP->getType ()), 0);
+	  if (!GEP->accumulateConstantOffset (DL, GEPOffset))
+	    V = nullptr;
+	  else
+	    {
+	      Offset += GEPOffset.getSExtValue ();
+	      V = GEP->getPointerOperand ();
+	    }
+	}
+      else
+	V = nullptr;
+    }
+
+  auto *DT = dyn_cast_or_null<GlobalVariable> (V);
+  if (!DT || !DT->isConstant () || !DT->hasDefinitiveInitializer ()
+      || Offset < 0)
+    {
+      Add_Unknown_Dispatch_Table (M, TypeId);
+      return;
+    }
+
+  DT->addTypeMetadata (Offset, MDString::get (M->getContext (), TypeId));
+  DT->setVCallVisibilityMetadata (GlobalObject::VCallVisibilityLinkageUnit);
+}
+
+/* Callee is the address of a subprogram that we're about to call, which
+   we loaded from the dispatch table of a type whose identifier is
+   TypeId.  Say so, as a test of the pointer to the dispatch table that
+   we assume is true, so that whole-program devirtualization can find the
+   possible callees.  Do nothing if Callee isn't such a load or if the
+   table we loaded it from was itself found at a negative or computed
+   offset from the tag, as for the table of predefined primitives, which
+   precedes the dispatch table.  */
+
+extern "C"
+void
+Add_Type_Test (Value *Callee, const char *TypeId)
+{
+  auto *Load = dyn_cast<LoadInst> (Callee->stripPointerCasts ());
+  if (!Load)
+    return;
+
+  Module *M = Load->getModule ();
+  LLVMContext &Ctx = M->getContext ();
+  const DataLayout &DL = M->getDataLayout ();
+  Value *Ptr = Load->getPointerOperand ();
+  APInt Offset (DL.getIndexTypeSizeInBits (Ptr->getType ()), 0);
+  Value *DT = Ptr->stripAndAccumulateConstantOffsets (DL, Offset, true);
+
+  if (auto *DTLoad = dyn_cast<LoadInst> (DT))
+    {
+      Value *TagPtr = DTLoad->getPointerOperand ();
+      APInt TagOffset (DL.getIndexTypeSizeInBits (TagPtr->getType ()), 0);
+      Value *Base
+	= TagPtr->stripAndAccumulateConstantOffsets (DL, TagOffset, true);
+
+      if (TagOffset.isNegative ()
+	  || Operator::getOpcode (Base) == Instruction::IntToPtr)
+	return;
+    }
+
+  IRBuilder<> Builder (Load);
+  Value *Test
+    = Builder.CreateCall (Intrinsic::getDeclaration (M, Intrinsic::type_test),
+			  {Builder.CreateBitCast (DT, Builder.getInt8PtrTy ()),
+			   MetadataAsValue::get (Ctx,
+						 MDString::get (Ctx, TypeId))});
+
+  Builder.CreateAssumption (Test);
+}
+
 extern "C"
 void
 Set_DSO_Local (GlobalVariable *GV)
@@ -528,24 +824,181 @@ Get_Metadata_Operand (MDNode *MD, unsigned i)
 
 extern "C"
 void
-Initialize_LLVM (void)
+Initialize_LLVM (const char *TargetTriple)
 {
   // Initialize the target registry etc.  These functions appear to be
   // in LLVM.Target, but they reference static inline function, so they
   // can only be used from C, not Ada.
+  //
+  // Initializing every target linked into the compiler takes a noticeable
+  // part of the time to compile a small unit, so we only initialize the
+  // one for TargetTriple.  To find it, register the information for each
+  // target in turn until looking up the triple succeeds.
+  std::string Error;
+  StringRef Found;
+
+#define LLVM_TARGET(Name)						\
+  if (Found.empty ())							\
+    {									\
+      LLVMInitialize##Name##TargetInfo ();				\
+      if (TargetRegistry::lookupTarget (TargetTriple, Error))		\
+	{								\
+	  LLVMInitialize##Name##Target ();				\
+	  LLVMInitialize##Name##TargetMC ();				\
+	  Found = #Name;						\
+	}								\
+    }
+#include "llvm/Config/Targets.def"
+
+#define LLVM_ASM_PRINTER(Name)						\
+  if (Found == #Name)							\
+    LLVMInitialize##Name##AsmPrinter ();
+#include "llvm/Config/AsmPrinters.def"
+
+#define LLVM_ASM_PARSER(Name)						\
+  if (Found == #Name)							\
+    LLVMInitialize##Name##AsmParser ();
+#include "llvm/Config/AsmParsers.def"
+
+  // If we don't know the target, initialize all of them, so the error
+  // we give later is the same as before.
+
+  if (Found.empty ())
+    {
+      InitializeAllTargetInfos ();
+      InitializeAllTargets ();
+      InitializeAllTargetMCs ();
+      InitializeAllAsmParsers ();
+      InitializeAllAsmPrinters ();
+    }
+}
+
+/* Support for -ftime-report and -ftime-trace.  The LLVM passes are timed
+   by the standard pass instrumentation, but we also time the phases of our
+   own processing, such as translating the GNAT tree into LLVM IR, both
+   with timers, to be printed in the report, and as entries in the time
+   trace.  */
+
+static bool TimeReport = false;
+static std::unique_ptr<TimerGroup> PhaseTimerGroup;
+static std::map<std::string, std::unique_ptr<Timer>> PhaseTimers;
+static SmallVector<Timer *, 4> ActivePhaseTimers;
+
+extern "C"
+void
+Initialize_Timing (bool TimeReportP, bool TimeTrace, unsigned Granularity)
+{
+  TimeReport = TimeReportP;
+  TimePassesIsEnabled = TimeReportP;
+  if (TimeReport)
+    PhaseTimerGroup.reset (new TimerGroup ("gnat-llvm",
+					   "GNAT LLVM phase timing report"));
+  if (TimeTrace)
+    timeTraceProfilerInitialize (Granularity, "gnat-llvm");
+}
+
+extern "C"
+void
+Start_Phase_Timer (const char *Name)
+{
+  if (TimeReport)
+    {
+      std::unique_ptr<Timer> &T = PhaseTimers[Name];
+
+      if (!T)
+	T.reset (new Timer (Name, Name, *PhaseTimerGroup));
+
+      T->startTimer ();
+      ActivePhaseTimers.push_back (T.get ());
+    }
+
+  if (timeTraceProfilerEnabled ())
+    timeTraceProfilerBegin (Name, StringRef ());
+}
+
+extern "C"
+void
+Stop_Phase_Timer (void)
+{
+  if (TimeReport)
+    ActivePhaseTimers.pop_back_val ()->stopTimer ();
+
+  if (timeTraceProfilerEnabled ())
+    timeTraceProfilerEnd ();
+}
+
+/* Print the timing report, if any, and write the time trace, if any, into
+   TraceFile.  Return true and set ErrorMessage if we can't do that.  */
+
+extern "C"
+LLVMBool
+Finalize_Timing (const char *TraceFile, char **ErrorMessage)
+{
+  if (TimeReport)
+    {
+      TimerGroup::printAll (errs ());
+      TimerGroup::clearAll ();
+    }
+
+  if (timeTraceProfilerEnabled ())
+    {
+      auto Err = timeTraceProfilerWrite (TraceFile, "");
+
+      timeTraceProfilerCleanup ();
+      if (Err)
+	{
+	  *ErrorMessage = strdup (toString (std::move (Err)).c_str ());
+	  return 1;
+	}
+    }
+
+  return 0;
+}
+
+/* Support for -fsave-optimization-record.  The remarks are written into
+   a file that must stay open until code generation is complete.  */
+
+static std::unique_ptr<ToolOutputFile> RemarksFile;
+
+extern "C"
+LLVMBool
+Initialize_Optimization_Remarks (Module *M, const char *Filename,
+				 const char *Passes, const char *Format,
+				 bool WithHotness, char **ErrorMessage)
+{
+  auto RF = setupLLVMOptimizationRemarks (M->getContext (), Filename,
+					  Passes == nullptr ? "" : Passes,
+					  Format, WithHotness);
+
+  if (auto Err = RF.takeError ())
+    {
+      *ErrorMessage = strdup (toString (std::move (Err)).c_str ());
+      return 1;
+    }
 
-  InitializeAllTargetInfos ();
-  InitializeAllTargets ();
-  InitializeAllTargetMCs ();
-  InitializeAllAsmParsers ();
-  InitializeAllAsmPrinters ();
+  RemarksFile = std::move (*RF);
+  return 0;
 }
 
-/* This is a dummy optimization "pass" that serves just to obtain loop
-   information when generating C.
+extern "C"
+void
+Finalize_Optimization_Remarks (Module *M)
+{
+  if (RemarksFile)
+    {
+      M->getContext ().setLLVMRemarkStreamer (nullptr);
+      M->getContext ().setMainRemarkStreamer (nullptr);
+      RemarksFile->keep ();
+      RemarksFile.reset ();
+    }
+}
 
-   For now, we don't actually do anything except collect information to look
-   at in the debugger.  */
+/* This is an optimization "pass" that doesn't change anything, but serves
+   to obtain loop information when generating C.  It runs after all other
+   optimizations and records, for each loop, the facts that the C
+   generator needs to write that loop as a C "for" loop.  The table is
+   keyed by the loop header and is valid until the next time we optimize
+   a module.  */
 
 namespace llvm
 {
@@ -563,87 +1016,848 @@ namespace llvm
   };
 }
 
+struct LoopFacts
+{
+  BasicBlock *Preheader = nullptr;
+  BasicBlock *Latch = nullptr;
+  BasicBlock *Exit = nullptr;
+  PHINode *InductionVariable = nullptr;
+  Value *InitialValue = nullptr;
+  Value *StepValue = nullptr;
+  Value *FinalValue = nullptr;
+  CmpInst::Predicate Predicate = CmpInst::BAD_ICMP_PREDICATE;
+  unsigned TripCount = 0;
+};
+
+static DenseMap<const BasicBlock *, LoopFacts> LoopFactsTable;
+
 PreservedAnalyses
 OurLoopPass::run (Loop &L, LoopAnalysisManager &LAM,
 		  LoopStandardAnalysisResults &AR, LPMUpdater &U)
 {
-
-  auto pre = L.getLoopPreheader ();
-  auto header = L.getHeader ();
-  auto latch = L.getLoopLatch ();
-  auto cmp = L.getLatchCmpInst ();
-  auto issimple = L.isLoopSimplifyForm ();
+  LoopFacts Facts;
+
+  Facts.Preheader = L.getLoopPreheader ();
+  Facts.Latch = L.getLoopLatch ();
+  Facts.Exit = L.getExitBlock ();
+  Facts.TripCount = AR.SE.getSmallConstantTripCount (&L);
+
+  /* We can only describe the induction variable, its bounds, and its
+     step if the loop is in simplified form.  The predicate is the one
+     that's true while we stay in the loop, with the induction variable
+     as its first operand.  */
+  if (L.isLoopSimplifyForm ())
+    if (auto Bounds = L.getBounds (AR.SE))
+      {
+	Facts.InductionVariable = L.getInductionVariable (AR.SE);
+	Facts.InitialValue = &Bounds->getInitialIVValue ();
+	Facts.StepValue = Bounds->getStepValue ();
+	Facts.FinalValue = &Bounds->getFinalIVValue ();
+	Facts.Predicate = Bounds->getCanonicalPredicate ();
+      }
+
+  LoopFactsTable[L.getHeader ()] = Facts;
   return PreservedAnalyses::all ();
 }
 
+/* Functions to query the loop information recorded above.  Each takes the
+   header of a loop.  */
+
+static const LoopFacts *
+Find_Loop_Facts (BasicBlock *Header)
+{
+  auto It = LoopFactsTable.find (Header);
+  return It == LoopFactsTable.end () ? nullptr : &It->second;
+}
+
 extern "C"
-LLVMBool
-LLVM_Optimize_Module (Module *M, TargetMachine *TM, int CodeOptLevel,
-		      int SizeOptLevel, bool NeedLoopInfo,
-		      bool NoUnrollLoops, bool NoLoopVectorization,
-		      bool NoSLPVectorization, bool MergeFunctions,
-		      bool PrepareForThinLTO, bool PrepareForLTO,
-		      bool RerollLoops, const char *PassPluginName,
-                      char** ErrorMessage)
+bool
+Is_Loop_Header (BasicBlock *BB)
 {
-  // This code is derived from EmitAssemblyWithNewPassManager in clang
+  return Find_Loop_Facts (BB);
+}
 
-  Optional<PGOOptions> PGOOpt;
-  PipelineTuningOptions PTO;
-  PassInstrumentationCallbacks PIC;
-  Triple TargetTriple (M->getTargetTriple ());
-  OptimizationLevel Level
-    = (CodeOptLevel == 1 ? OptimizationLevel::O1
-       : CodeOptLevel == 2 ? OptimizationLevel::O2
-       : CodeOptLevel == 3 ? OptimizationLevel::O3
-       : OptimizationLevel::O0);
-  PTO.LoopUnrolling = !NoUnrollLoops;
-  PTO.LoopInterleaving = !NoUnrollLoops;
-  PTO.LoopVectorization = !NoLoopVectorization;
-  PTO.SLPVectorization = !NoSLPVectorization;
-  PTO.MergeFunctions = MergeFunctions;
+extern "C"
+unsigned
+Get_Loop_Trip_Count (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->TripCount : 0;
+}
 
-  LoopAnalysisManager LAM;
-  FunctionAnalysisManager FAM;
-  CGSCCAnalysisManager CGAM;
-  ModuleAnalysisManager MAM;
+extern "C"
+BasicBlock *
+Get_Loop_Preheader (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->Preheader : nullptr;
+}
 
-  PassBuilder PB (TM, PTO, PGOOpt, &PIC);
+extern "C"
+BasicBlock *
+Get_Loop_Latch (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->Latch : nullptr;
+}
 
-  if (PassPluginName != nullptr)
-    {
-      auto Plugin = PassPlugin::Load (PassPluginName);
+extern "C"
+BasicBlock *
+Get_Loop_Exit_Block (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->Exit : nullptr;
+}
 
-      if (auto Err = Plugin.takeError())
-        {
-          handleAllErrors(std::move(Err), [&](const StringError &Err) {
-            if (ErrorMessage != nullptr)
-              *ErrorMessage = strdup (Err.getMessage().c_str());
-          });
+extern "C"
+Value *
+Get_Loop_Induction_Variable (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->InductionVariable : nullptr;
+}
 
-          return 1;
-        }
+extern "C"
+Value *
+Get_Loop_Initial_Value (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->InitialValue : nullptr;
+}
 
-      Plugin->registerPassBuilderCallbacks(PB);
-    }
+extern "C"
+Value *
+Get_Loop_Step (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->StepValue : nullptr;
+}
 
-  FAM.registerPass ([&] { return PB.buildDefaultAAPipeline (); });
+extern "C"
+Value *
+Get_Loop_Bound (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return Facts ? Facts->FinalValue : nullptr;
+}
 
-  // Register the target library analysis directly and give it a customized
-  // preset TLI.
-  TargetLibraryInfoImpl *TLII = new TargetLibraryInfoImpl(TargetTriple);
-  FAM.registerPass ([&] { return TargetLibraryAnalysis (*TLII); });
+extern "C"
+LLVMIntPredicate
+Get_Loop_Predicate (BasicBlock *Header)
+{
+  auto Facts = Find_Loop_Facts (Header);
+  return (LLVMIntPredicate) (Facts ? Facts->Predicate
+			     : CmpInst::BAD_ICMP_PREDICATE);
+}
 
-  // Register all the basic analyses with the managers.
+/* This is a pass that recognizes the checks generated for Ada, which
+   branch to a block that raises an exception when the check fails, and
+   puts them into the form that the inductive range check elimination
+   pass (IRCE) recognizes, where the branch is taken when the check
+   passes.  IRCE can then version a loop containing an index check into
+   one that checks up front that the whole iteration space is in range
+   and runs without the check, and the original loop for the rest.  */
 
-  PB.registerModuleAnalyses (MAM);
-  PB.registerCGSCCAnalyses (CGAM);
-  PB.registerFunctionAnalyses (FAM);
-  PB.registerLoopAnalyses (LAM);
-  PB.crossRegisterProxies (LAM, FAM, CGAM, MAM);
+namespace llvm
+{
+  struct OurCheckPass : PassInfoMixin<OurCheckPass>
+  {
+  public:
+    PreservedAnalyses run (Function &F, FunctionAnalysisManager &FAM);
+  };
+}
 
-  ModulePassManager MPM;
-  if (CodeOptLevel == 0)
+/* Return true if BB raises an exception: if it ends by calling a function
+   that doesn't return.  */
+
+static bool
+Is_Raise_Block (BasicBlock *BB)
+{
+  if (auto *Invoke = dyn_cast<InvokeInst> (BB->getTerminator ()))
+    return Invoke->doesNotReturn ();
+
+  auto *Term = dyn_cast<UnreachableInst> (BB->getTerminator ());
+  if (!Term || !Term->getPrevNode ())
+    return false;
+
+  auto *Call = dyn_cast<CallInst> (Term->getPrevNode ());
+  return Call && Call->doesNotReturn ();
+}
+
+/* If V, the condition of a branch, is a comparison or an "or" of
+   comparisons, each used only there, invert it in place and return
+   true.  */
+
+static bool
+Invert_Check_Condition (Value *V)
+{
+  if (!V->hasOneUse ())
+    return false;
+
+  if (auto *Cmp = dyn_cast<ICmpInst> (V))
+    {
+      Cmp->setPredicate (Cmp->getInversePredicate ());
+      return true;
+    }
+
+  auto *Or = dyn_cast<BinaryOperator> (V);
+  if (!Or || Or->getOpcode () != Instruction::Or
+      || !Or->getType ()->isIntegerTy (1))
+    return false;
+
+  auto *LHS = dyn_cast<ICmpInst> (Or->getOperand (0));
+  auto *RHS = dyn_cast<ICmpInst> (Or->getOperand (1));
+  if (!LHS || !RHS || LHS == RHS || !LHS->hasOneUse () || !RHS->hasOneUse ())
+    return false;
+
+  LHS->setPredicate (LHS->getInversePredicate ());
+  RHS->setPredicate (RHS->getInversePredicate ());
+  auto *And = BinaryOperator::CreateAnd (LHS, RHS, "", Or);
+  And->takeName (Or);
+  Or->replaceAllUsesWith (And);
+  Or->eraseFromParent ();
+  return true;
+}
+
+PreservedAnalyses
+OurCheckPass::run (Function &F, FunctionAnalysisManager &FAM)
+{
+  bool Changed = false;
+
+  for (BasicBlock &BB : F)
+    {
+      auto *Br = dyn_cast<BranchInst> (BB.getTerminator ());
+      if (Br && Br->isConditional () && Is_Raise_Block (Br->getSuccessor (0))
+	  && !Is_Raise_Block (Br->getSuccessor (1))
+	  && Invert_Check_Condition (Br->getCondition ()))
+	{
+	  Br->swapSuccessors ();
+	  Changed = true;
+	}
+    }
+
+  return Changed ? PreservedAnalyses::none () : PreservedAnalyses::all ();
+}
+
+/* This is a pass that shares the blocks that raise an exception when a
+   check fails.  We generate one such block for each check, but all it
+   does is call one of the __gnat_rcheck routines, so we can merge all
+   those that call the same routine with the same file name into one,
+   passing it the line number with a PHI.  This keeps most of the raise
+   code out of the hot path, which we also indicate by marking each
+   branch to a raise block as very unlikely.  */
+
+namespace llvm
+{
+  struct OurRaisePass : PassInfoMixin<OurRaisePass>
+  {
+  public:
+    PreservedAnalyses run (Function &F, FunctionAnalysisManager &FAM);
+  };
+}
+
+/* If BB consists of only a call, or an invoke, of a function that doesn't
+   return, return it.  */
+
+static CallBase *
+Get_Raise_Call (BasicBlock *BB)
+{
+  auto *Call = dyn_cast<CallBase> (BB->getFirstNonPHIOrDbg ());
+  if (!Call || isa<PHINode> (BB->front ()) || !Call->doesNotReturn ()
+      || !Call->getCalledFunction ()
+      || Call->getCalledFunction ()->isIntrinsic ()
+      || Call->hasOperandBundles ())
+    return nullptr;
+
+  if (isa<CallInst> (Call))
+    return isa<UnreachableInst> (Call->getNextNode ()) ? Call : nullptr;
+
+  auto *Invoke = cast<InvokeInst> (Call);
+  BasicBlock *Normal = Invoke->getNormalDest ();
+  if (!isa<UnreachableInst> (Normal->getFirstNonPHIOrDbg ())
+      || isa<PHINode> (Invoke->getUnwindDest ()->front ()))
+    return nullptr;
+
+  return Call;
+}
+
+/* Replace the raise blocks containing Calls, which all call the same
+   routine with the same file name and the same unwind destination, by a
+   single block in F.  */
+
+static void
+Merge_Raise_Blocks (Function &F, ArrayRef<CallBase *> Calls)
+{
+  CallBase *First = Calls.front ();
+  BasicBlock *NewBB = BasicBlock::Create (F.getContext (),
+					  First->getParent ()->getName (),
+					  &F);
+  IRBuilder<> Builder (NewBB);
+  CallBase *NewCall = cast<CallBase> (First->clone ());
+  const DILocation *Loc = First->getDebugLoc ().get ();
+
+  // For each operand that differs between the calls, make a PHI
+  // giving its value for each predecessor.
+
+  for (unsigned i = 0; i < First->arg_size (); i++)
+    {
+      Value *Arg = First->getArgOperand (i);
+      if (all_of (Calls, [&] (CallBase *Call) {
+	    return Call->getArgOperand (i) == Arg; }))
+	continue;
+
+      PHINode *Phi = Builder.CreatePHI (Arg->getType (), Calls.size ());
+      for (CallBase *Call : Calls)
+	for (BasicBlock *Pred : predecessors (Call->getParent ()))
+	  Phi->addIncoming (Call->getArgOperand (i), Pred);
+
+      NewCall->setArgOperand (i, Phi);
+    }
+
+  for (CallBase *Call : Calls)
+    Loc = DILocation::getMergedLocation (Loc, Call->getDebugLoc ().get ());
+
+  Builder.Insert (NewCall);
+  NewCall->setDebugLoc (DebugLoc (Loc));
+  if (isa<CallInst> (NewCall))
+    Builder.CreateUnreachable ();
+
+  // Finally, redirect the branches to the old blocks to the new one
+  // and delete the old ones, along with the blocks they used as a
+  // normal destination for an invoke, if nothing else uses them.
+
+  for (CallBase *Call : Calls)
+    {
+      BasicBlock *BB = Call->getParent ();
+      auto *Invoke = dyn_cast<InvokeInst> (Call);
+      BasicBlock *Normal
+	= Invoke && Call != First ? Invoke->getNormalDest () : nullptr;
+
+      BB->replaceAllUsesWith (NewBB);
+      DeleteDeadBlock (BB);
+      if (Normal && pred_empty (Normal))
+	DeleteDeadBlock (Normal);
+    }
+}
+
+PreservedAnalyses
+OurRaisePass::run (Function &F, FunctionAnalysisManager &FAM)
+{
+  typedef std::tuple<Function *, Value *, BasicBlock *> Raise_Key;
+  MapVector<Raise_Key, SmallVector<CallBase *, 4>> Raises;
+  bool Changed = false;
+
+  // First collect the raise blocks, keyed by the routine they call, the
+  // file name they pass it, and where an exception goes.
+
+  for (BasicBlock &BB : F)
+    if (CallBase *Call = Get_Raise_Call (&BB))
+      {
+	auto *Invoke = dyn_cast<InvokeInst> (Call);
+	Raises[Raise_Key (Call->getCalledFunction (),
+			  Call->arg_size () > 0 ? Call->getArgOperand (0)
+			  : nullptr,
+			  Invoke ? Invoke->getUnwindDest () : nullptr)]
+	  .push_back (Call);
+      }
+
+  // Now split each group into subgroups in which no block branches to
+  // two raise blocks that pass different arguments, since a PHI can only
+  // give one value for each predecessor, and replace each subgroup of
+  // more than one with a single block.
+
+  for (auto &Entry : Raises)
+    {
+      SmallVector<SmallVector<CallBase *, 4>, 2> Groups;
+      SmallVector<DenseMap<BasicBlock *, CallBase *>, 2> Group_Preds;
+
+      if (Entry.second.size () < 2)
+	continue;
+
+      for (CallBase *Call : Entry.second)
+	{
+	  unsigned j = 0;
+
+	  for (; j < Groups.size (); j++)
+	    if (all_of (predecessors (Call->getParent ()),
+			[&] (BasicBlock *Pred) {
+			  CallBase *Other = Group_Preds[j].lookup (Pred);
+			  return (!Other
+				  || equal (Other->args (), Call->args ()));
+			}))
+	      break;
+
+	  if (j == Groups.size ())
+	    {
+	      Groups.emplace_back ();
+	      Group_Preds.emplace_back ();
+	    }
+
+	  Groups[j].push_back (Call);
+	  for (BasicBlock *Pred : predecessors (Call->getParent ()))
+	    Group_Preds[j].try_emplace (Pred, Call);
+	}
+
+      for (SmallVector<CallBase *, 4> &Calls : Groups)
+	if (Calls.size () >= 2)
+	  {
+	    Merge_Raise_Blocks (F, Calls);
+	    Changed = true;
+	  }
+    }
+
+  // Mark each branch to a raise block as very unlikely to be taken
+
+  MDBuilder MDB (F.getContext ());
+  for (BasicBlock &BB : F)
+    {
+      auto *Br = dyn_cast<BranchInst> (BB.getTerminator ());
+      if (!Br || !Br->isConditional ()
+	  || Br->hasMetadata (LLVMContext::MD_prof))
+	continue;
+
+      bool Raise0 = Is_Raise_Block (Br->getSuccessor (0));
+      bool Raise1 = Is_Raise_Block (Br->getSuccessor (1));
+
+      if (Raise0 != Raise1)
+	{
+	  Br->setMetadata (LLVMContext::MD_prof,
+			   Raise0 ? MDB.createBranchWeights (1, 2000)
+			   : MDB.createBranchWeights (2000, 1));
+	  Changed = true;
+	}
+    }
+
+  return Changed ? PreservedAnalyses::none () : PreservedAnalyses::all ();
+}
+
+/* This is a pass that replaces a call to the default allocator by an
+   allocation on the stack when the size is small and known and when the
+   memory can't be used once the function returns: when the address is
+   only used to access the memory, to compare it, or to free it.  The
+   calls that free it are then deleted.  This is common for an object
+   that's allocated and freed by the same subprogram.  We limit how much
+   this can grow a frame and don't do it in functions that may recurse,
+   since each activation would then take that much more stack.  */
+
+namespace llvm
+{
+  struct OurHeapToStackPass : PassInfoMixin<OurHeapToStackPass>
+  {
+  public:
+    PreservedAnalyses run (Function &F, FunctionAnalysisManager &FAM);
+  };
+}
+
+/* This is the largest allocation, in bytes, that we'll move to the
+   stack.  */
+
+static const uint64_t Max_Heap_To_Stack_Size = 1024;
+
+/* This is the largest that we'll let the fixed part of a frame become by
+   moving allocations to the stack.  */
+
+static const uint64_t Max_Heap_To_Stack_Frame = 4096;
+
+/* This is the largest number of functions that we'll look at to see if
+   a function may call itself.  */
+
+static const unsigned Max_Recursion_Search = 256;
+
+/* Return true if Fn, called from Caller, is the default allocation
+   function, if Alloc, or deallocation function, if not, and we're allowed
+   to assume that it's the one we know.  */
+
+static bool
+Is_Default_Alloc_Fn (Function *Fn, bool Alloc, Function &Caller)
+{
+  if (!Fn || Fn->arg_size () != 1)
+    return false;
+
+  StringRef Name = Fn->getName ();
+  if (Alloc ? Name != "__gnat_malloc" && Name != "malloc"
+      : Name != "__gnat_free" && Name != "free")
+    return false;
+
+  return !Caller.hasFnAttribute ("no-builtin-" + Name.str ());
+}
+
+/* Return true if the memory pointed to by V, which is derived from the
+   result of an allocation in F and is the start of it if Base, can't be
+   accessed once F returns.  Add the calls that free it to Frees.  */
+
+static bool
+Is_Local_Allocation (Value *V, bool Base, Function &F,
+		     SmallVectorImpl<CallBase *> &Frees)
+{
+  for (User *U : V->users ())
+    {
+      if (isa<BitCastInst> (U))
+	{
+	  if (!Is_Local_Allocation (U, Base, F, Frees))
+	    return false;
+	}
+      else if (isa<GetElementPtrInst> (U))
+	{
+	  if (!Is_Local_Allocation (U, false, F, Frees))
+	    return false;
+	}
+      else if (auto *Load = dyn_cast<LoadInst> (U))
+	{
+	  if (Load->isVolatile ())
+	    return false;
+	}
+      else if (auto *Store = dyn_cast<StoreInst> (U))
+	{
+	  if (Store->isVolatile () || Store->getValueOperand () == V)
+	    return false;
+	}
+      else if (auto *MI = dyn_cast<MemIntrinsic> (U))
+	{
+	  if (MI->isVolatile ())
+	    return false;
+	}
+      else if (auto *Call = dyn_cast<CallBase> (U))
+	{
+	  if (Call->isLifetimeStartOrEnd ())
+	    continue;
+	  else if (!Base
+		   || !Is_Default_Alloc_Fn (Call->getCalledFunction (), false,
+					    F))
+	    return false;
+
+	  Frees.push_back (Call);
+	}
+      else if (!isa<ICmpInst> (U))
+	return false;
+    }
+
+  return true;
+}
+
+/* Return true if F may call itself, directly or through other functions
+   defined in this module.  We assume that an indirect call may call F
+   if its address is taken and that functions declared here don't call
+   back into F.  If the search goes on too long, assume F may recurse.  */
+
+static bool
+May_Recurse (Function &F)
+{
+  SmallPtrSet<Function *, 16> Visited;
+  SmallVector<Function *, 16> Worklist = {&F};
+  bool Address_Taken = F.hasAddressTaken ();
+
+  if (F.doesNotRecurse ())
+    return false;
+
+  while (!Worklist.empty ())
+    {
+      Function *G = Worklist.pop_back_val ();
+
+      for (Instruction &I : instructions (*G))
+	if (auto *Call = dyn_cast<CallBase> (&I))
+	  {
+	    Function *Callee = Call->getCalledFunction ();
+
+	    if (!Callee)
+	      {
+		if (Address_Taken && !Call->isInlineAsm ())
+		  return true;
+	      }
+	    else if (Callee == &F)
+	      return true;
+	    else if (!Callee->isDeclaration () && !Callee->doesNotRecurse ()
+		     && Visited.insert (Callee).second)
+	      {
+		if (Visited.size () > Max_Recursion_Search)
+		  return true;
+
+		Worklist.push_back (Callee);
+	      }
+	  }
+    }
+
+  return false;
+}
+
+PreservedAnalyses
+OurHeapToStackPass::run (Function &F, FunctionAnalysisManager &FAM)
+{
+  const DataLayout &DL = F.getParent ()->getDataLayout ();
+  SmallVector<CallBase *, 4> Allocs;
+  uint64_t Frame_Size = 0;
+  bool Changed = false;
+
+  if (F.hasFnAttribute ("no-builtins"))
+    return PreservedAnalyses::all ();
+
+  for (Instruction &I : instructions (F))
+    if (auto *Call = dyn_cast<CallBase> (&I))
+      if (Is_Default_Alloc_Fn (Call->getCalledFunction (), true, F))
+	Allocs.push_back (Call);
+
+  if (Allocs.empty () || May_Recurse (F))
+    return PreservedAnalyses::all ();
+
+  // Find the size of the fixed part of the frame, including what we
+  // moved there in previous runs.
+
+  for (Instruction &I : F.getEntryBlock ())
+    if (auto *Alloca = dyn_cast<AllocaInst> (&I))
+      if (Optional<TypeSize> Size = Alloca->getAllocationSizeInBits (DL))
+	if (!Size->isScalable ())
+	  Frame_Size += Size->getFixedSize () / 8;
+
+  for (CallBase *Call : Allocs)
+    {
+      auto *Size = dyn_cast<ConstantInt> (Call->getArgOperand (0));
+      SmallVector<CallBase *, 4> Frees;
+
+      if (!Size || Size->isZero ()
+	  || Size->getZExtValue () > Max_Heap_To_Stack_Size
+	  || Frame_Size + Size->getZExtValue () > Max_Heap_To_Stack_Frame
+	  || !Is_Local_Allocation (Call, true, F, Frees))
+	continue;
+
+      // Make a variable in the entry block of the same size and with the
+      // alignment of the system allocator.  We only need one even if the
+      // allocation is in a loop, since the memory from a previous
+      // iteration can no longer be reached.
+
+      IRBuilder<> Builder (&*F.getEntryBlock ().getFirstInsertionPt ());
+      AllocaInst *Alloca
+	= Builder.CreateAlloca (ArrayType::get (Builder.getInt8Ty (),
+						Size->getZExtValue ()));
+      Alloca->setAlignment (Align (2 * DL.getPointerSize ()));
+      Alloca->takeName (Call);
+
+      for (CallBase *Free : Frees)
+	{
+	  if (auto *Invoke = dyn_cast<InvokeInst> (Free))
+	    Free = changeToCall (Invoke);
+
+	  Free->eraseFromParent ();
+	}
+
+      if (auto *Invoke = dyn_cast<InvokeInst> (Call))
+	Call = changeToCall (Invoke);
+
+      Call->replaceAllUsesWith (Builder.CreatePointerCast (Alloca,
+							   Call->getType ()));
+      Call->eraseFromParent ();
+      Frame_Size += Size->getZExtValue ();
+      Changed = true;
+    }
+
+  return Changed ? PreservedAnalyses::none () : PreservedAnalyses::all ();
+}
+
+extern "C"
+LLVMBool
+LLVM_Optimize_Module (Module *M, TargetMachine *TM, int CodeOptLevel,
+		      int SizeOptLevel, bool NeedLoopInfo,
+		      bool NoUnrollLoops, bool NoLoopVectorization,
+		      bool NoSLPVectorization, bool MergeFunctions,
+		      bool PrepareForThinLTO, bool PrepareForLTO,
+		      bool RerollLoops, const char *PassPluginName,
+		      const char *ProfileGenFile, const char *ProfileUseFile,
+		      const char *SampleUseFile, bool DebugInfoForProfiling,
+		      int VectorLibrary, bool NoBuiltins,
+		      const char *NoBuiltinFunctions,
+		      bool NoLoopCheckVersioning, bool NoHotColdSplit,
+		      char** ErrorMessage)
+{
+  // This code is derived from EmitAssemblyWithNewPassManager in clang
+
+  Optional<PGOOptions> PGOOpt;
+  PipelineTuningOptions PTO;
+  PassInstrumentationCallbacks PIC;
+  Triple TargetTriple (M->getTargetTriple ());
+  OptimizationLevel Level
+    = (CodeOptLevel == 0 ? OptimizationLevel::O0
+       : SizeOptLevel == 1 ? OptimizationLevel::Os
+       : SizeOptLevel == 2 ? OptimizationLevel::Oz
+       : CodeOptLevel == 1 ? OptimizationLevel::O1
+       : CodeOptLevel == 2 ? OptimizationLevel::O2
+       : OptimizationLevel::O3);
+  PTO.LoopUnrolling = !NoUnrollLoops;
+  PTO.LoopInterleaving = !NoUnrollLoops;
+  PTO.LoopVectorization = !NoLoopVectorization;
+  PTO.SLPVectorization = !NoSLPVectorization;
+  PTO.MergeFunctions = MergeFunctions;
+
+  // If optimizing for size, say so on each function we define, as clang
+  // does, so that the code generator, as well as the inliner and other
+  // optimizations, favor smaller code.
+
+  if (CodeOptLevel > 0 && SizeOptLevel > 0)
+    for (Function &F : *M)
+      if (!F.isDeclaration ()
+	  && !F.hasFnAttribute (Attribute::OptimizeNone))
+	{
+	  F.addFnAttr (Attribute::OptimizeForSize);
+	  if (SizeOptLevel == 2)
+	    F.addFnAttr (Attribute::MinSize);
+	}
+
+  // If we're doing profile-guided optimization, either instrument the
+  // code to produce a profile or use a profile produced that way or by
+  // sampling.  The sample profile loader only looks at functions that
+  // are marked as wanting it.  Even without a profile, we may have been
+  // asked to add discriminators to the debug information so that the
+  // resulting code can be sampled.
+
+  if (ProfileGenFile != nullptr)
+    PGOOpt = PGOOptions (ProfileGenFile, "", "", PGOOptions::IRInstr,
+			 PGOOptions::NoCSAction, DebugInfoForProfiling);
+  else if (ProfileUseFile != nullptr)
+    PGOOpt = PGOOptions (ProfileUseFile, "", "", PGOOptions::IRUse,
+			 PGOOptions::NoCSAction, DebugInfoForProfiling);
+  else if (SampleUseFile != nullptr)
+    {
+      PGOOpt = PGOOptions (SampleUseFile, "", "", PGOOptions::SampleUse,
+			   PGOOptions::NoCSAction, true);
+      for (Function &F : *M)
+	if (!F.isDeclaration ())
+	  F.addFnAttr ("use-sample-profile");
+    }
+  else if (DebugInfoForProfiling)
+    PGOOpt = PGOOptions ("", "", "", PGOOptions::NoAction,
+			 PGOOptions::NoCSAction, true);
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+
+  // Register the standard instrumentation, which, among other things,
+  // times passes if requested.
+
+  StandardInstrumentations SI (false);
+  SI.registerCallbacks (PIC, &FAM);
+
+  PassBuilder PB (TM, PTO, PGOOpt, &PIC);
+
+  if (PassPluginName != nullptr)
+    {
+      auto Plugin = PassPlugin::Load (PassPluginName);
+
+      if (auto Err = Plugin.takeError())
+        {
+          handleAllErrors(std::move(Err), [&](const StringError &Err) {
+            if (ErrorMessage != nullptr)
+              *ErrorMessage = strdup (Err.getMessage().c_str());
+          });
+
+          return 1;
+        }
+
+      Plugin->registerPassBuilderCallbacks(PB);
+    }
+
+  // Unless told not to, version loops to hoist the index checks of the
+  // Ada code out of them.  Do this at the end of the simplification of
+  // each function, once loops have been canonicalized, but before they're
+  // vectorized and unrolled.
+
+  if (CodeOptLevel >= 2 && !NoLoopCheckVersioning)
+    PB.registerScalarOptimizerLateEPCallback
+      ([] (FunctionPassManager &FPM, OptimizationLevel Level) {
+	FPM.addPass (OurCheckPass ());
+	FPM.addPass (IRCEPass ());
+      });
+
+  // When optimizing, share the blocks that raise exceptions for failed
+  // checks and mark them as cold, both before inlining and again at the
+  // end, for those that inlining has brought in.
+
+  if (CodeOptLevel > 0)
+    {
+      PB.registerPipelineStartEPCallback
+	([] (ModulePassManager &MPM, OptimizationLevel Level) {
+	  MPM.addPass (createModuleToFunctionPassAdaptor (OurRaisePass ()));
+	});
+      PB.registerOptimizerLastEPCallback
+	([] (ModulePassManager &MPM, OptimizationLevel Level) {
+	  MPM.addPass (createModuleToFunctionPassAdaptor (OurRaisePass ()));
+	});
+    }
+
+  // When optimizing, move small allocations that don't outlive the
+  // function to the stack.  Do this once the early scalar optimizations
+  // have put the access variables into registers, so we can see all uses
+  // of the allocated memory.
+
+  if (CodeOptLevel > 0)
+    PB.registerPeepholeEPCallback
+      ([] (FunctionPassManager &FPM, OptimizationLevel Level) {
+	FPM.addPass (OurHeapToStackPass ());
+      });
+
+  // Unless told not to, move cold code, such as the bodies of exception
+  // handlers and the raise blocks above, into separate functions, which
+  // will be placed in .text.unlikely.  Landing pads themselves, and
+  // blocks ending in an invoke, can't be extracted and stay in place.
+  // We don't do this when preparing for LTO, since the function must
+  // stay whole until the link, but LLVM's LTO pipeline doesn't split
+  // either unless the linker is passed -mllvm -hot-cold-split, so with
+  // -flto this switch has no effect.
+
+  if (CodeOptLevel >= 2 && !NoHotColdSplit && !PrepareForThinLTO
+      && !PrepareForLTO)
+    PB.registerOptimizerLastEPCallback
+      ([] (ModulePassManager &MPM, OptimizationLevel Level) {
+	MPM.addPass (HotColdSplittingPass ());
+      });
+
+  FAM.registerPass ([&] { return PB.buildDefaultAAPipeline (); });
+
+  // Register the target library analysis directly and give it a customized
+  // preset TLI, which says what vector library we can use and what library
+  // functions we can't assume are the standard ones.  Also record the
+  // latter as function attributes, as clang does, so that it's also known
+  // during code generation.
+  TargetLibraryInfoImpl TLII (TargetTriple);
+  SmallVector<StringRef, 4> NoBuiltinNames;
+
+  TLII.addVectorizableFunctionsFromVecLib
+    ((TargetLibraryInfoImpl::VectorLibrary) VectorLibrary);
+  if (NoBuiltinFunctions != nullptr)
+    StringRef (NoBuiltinFunctions).split (NoBuiltinNames, ',', -1, false);
+
+  if (NoBuiltins)
+    TLII.disableAllFunctions ();
+  else
+    for (StringRef Name : NoBuiltinNames)
+      {
+	LibFunc F;
+
+	if (TLII.getLibFunc (Name, F))
+	  TLII.setUnavailable (F);
+      }
+
+  for (Function &F : *M)
+    if (!F.isDeclaration ())
+      {
+	if (NoBuiltins)
+	  F.addFnAttr ("no-builtins");
+	else
+	  for (StringRef Name : NoBuiltinNames)
+	    F.addFnAttr ("no-builtin-" + Name.str ());
+      }
+
+  FAM.registerPass ([&] { return TargetLibraryAnalysis (TLII); });
+
+  // Register all the basic analyses with the managers.
+
+  PB.registerModuleAnalyses (MAM);
+  PB.registerCGSCCAnalyses (CGAM);
+  PB.registerFunctionAnalyses (FAM);
+  PB.registerLoopAnalyses (LAM);
+  PB.crossRegisterProxies (LAM, FAM, CGAM, MAM);
+
+  ModulePassManager MPM;
+  if (CodeOptLevel == 0)
     {
       MPM = PB.buildO0DefaultPipeline (Level,
 				       PrepareForLTO || PrepareForThinLTO);
@@ -659,12 +1873,541 @@ LLVM_Optimize_Module (Module *M, TargetMachine *TM, int CodeOptLevel,
     MPM = PB.buildPerModuleDefaultPipeline (Level);
 
   if (NeedLoopInfo)
-    MPM.addPass (createModuleToFunctionPassAdaptor
-		 (createFunctionToLoopPassAdaptor (OurLoopPass ())));
+    {
+      LoopFactsTable.clear ();
+      MPM.addPass (createModuleToFunctionPassAdaptor
+		   (createFunctionToLoopPassAdaptor (OurLoopPass ())));
+    }
   MPM.run (*M, MAM);
   return 0;
 }
 
+/* Write into ReportFile the total size of the code, initialized data,
+   read-only data, zero-initialized data, and unwind tables in the object
+   file ObjectFilename.  Return true and set ErrorMessage if we can't read
+   the object file or write the report.  */
+
+extern "C"
+LLVMBool
+Write_Size_Report (const char *ObjectFilename, const char *ReportFile,
+		   char **ErrorMessage)
+{
+  auto ObjOrErr = object::ObjectFile::createObjectFile (ObjectFilename);
+  if (!ObjOrErr)
+    {
+      *ErrorMessage = strdup (toString (ObjOrErr.takeError ()).c_str ());
+      return 1;
+    }
+
+  uint64_t Text = 0, Data = 0, ROData = 0, BSS = 0, EHFrame = 0;
+  for (const object::SectionRef &Sec : ObjOrErr->getBinary ()->sections ())
+    {
+      Expected<StringRef> NameOrErr = Sec.getName ();
+      StringRef Name = NameOrErr ? *NameOrErr : StringRef ();
+      if (!NameOrErr)
+	consumeError (NameOrErr.takeError ());
+
+      if (Name == ".eh_frame" || Name == "__eh_frame")
+	EHFrame += Sec.getSize ();
+      else if (Sec.isText ())
+	Text += Sec.getSize ();
+      else if (Sec.isBSS ())
+	BSS += Sec.getSize ();
+      else if (Sec.isData ()
+	       && (Name.startswith (".rodata") || Name.startswith (".rdata")
+		   || Name == "__const" || Name == "__cstring"
+		   || Name.startswith ("__literal")))
+	ROData += Sec.getSize ();
+      else if (Sec.isData ())
+	Data += Sec.getSize ();
+    }
+
+  std::error_code EC;
+  raw_fd_ostream OS (ReportFile, EC, sys::fs::OF_Text);
+  if (EC)
+    {
+      *ErrorMessage = strdup (EC.message ().c_str ());
+      return 1;
+    }
+
+  OS << "text\t" << Text << "\n" << "data\t" << Data << "\n"
+     << "rodata\t" << ROData << "\n" << "bss\t" << BSS << "\n"
+     << "eh_frame\t" << EHFrame << "\n";
+  return 0;
+}
+
+/* Generate code of kind Kind for M into Filename.  We first emit into
+   memory and then write the result with a single call, which avoids the
+   seeks and small writes of the object writers, which are slow on
+   network filesystems.  Return true and set ErrorMessage if we can't do
+   that.  */
+
+extern "C"
+LLVMBool
+Emit_To_File_Buffered (Module *M, TargetMachine *TM, const char *Filename,
+		       LLVMCodeGenFileType Kind, char **ErrorMessage)
+{
+  SmallVector<char, 0> Buffer;
+  raw_svector_ostream BOS (Buffer);
+  legacy::PassManager PM;
+  CodeGenFileType FT
+    = Kind == LLVMAssemblyFile ? CGFT_AssemblyFile : CGFT_ObjectFile;
+
+  M->setDataLayout (TM->createDataLayout ());
+  if (TM->addPassesToEmitFile (PM, BOS, nullptr, FT))
+    {
+      *ErrorMessage = strdup ("TargetMachine can't emit a file of this type");
+      return 1;
+    }
+
+  PM.run (*M);
+
+  std::error_code EC;
+  raw_fd_ostream OS (Filename, EC,
+		     FT == CGFT_AssemblyFile ? sys::fs::OF_Text
+		     : sys::fs::OF_None);
+  if (!EC)
+    {
+      OS.write (Buffer.data (), Buffer.size ());
+      OS.close ();
+      EC = OS.error ();
+      OS.clear_error ();
+    }
+
+  if (EC)
+    {
+      *ErrorMessage = strdup (EC.message ().c_str ());
+      return 1;
+    }
+
+  return 0;
+}
+
+/* Embed the bitcode of M, as it is now, into a section of M itself
+   (.llvmbc, or __LLVM,__bitcode on Darwin), so that it's carried along
+   in the object file we generate from M.  */
+
+extern "C"
+void
+Embed_Module_Bitcode (Module *M)
+{
+  embedBitcodeInModule (*M, MemoryBufferRef (), true, false, {});
+}
+
+/* Write an object file for M into Filename by splitting M into Jobs
+   partitions and generating code for each in its own thread, using a
+   TargetMachine that's a copy of TM.  We then combine the resulting
+   objects into Filename with a relocatable link.  Return true and set
+   ErrorMessage if we can't do that.  */
+
+extern "C"
+LLVMBool
+Emit_Object_In_Parallel (Module *M, TargetMachine *TM, unsigned Jobs,
+			 const char *Filename, char **ErrorMessage)
+{
+  auto Fail = [&] (const Twine &Msg) {
+    *ErrorMessage = strdup (Msg.str ().c_str ());
+    return 1;
+  };
+
+  /* Find the linker, preferring one for our target.  */
+  std::string Triple = TM->getTargetTriple ().str ();
+  auto Linker = findProgramByName (Triple + "-ld");
+  if (!Linker)
+    Linker = findProgramByName ("ld");
+  if (!Linker)
+    return Fail ("cannot find ld to combine partitions");
+
+  /* Open a temporary file for each partition.  */
+  SmallVector<std::string, 8> PartFiles;
+  std::vector<std::unique_ptr<raw_fd_ostream>> Streams;
+  SmallVector<raw_pwrite_stream *, 8> OSs;
+  auto Cleanup = [&] () {
+    Streams.clear ();
+    for (auto &F : PartFiles)
+      fs::remove (F);
+  };
+
+  for (unsigned i = 0; i < Jobs; i++)
+    {
+      int FD;
+      SmallString<128> Path;
+
+      if (auto EC = fs::createTemporaryFile ("gnatllvm", "o", FD, Path))
+	{
+	  Cleanup ();
+	  return Fail ("cannot create temporary file: " + EC.message ());
+	}
+
+      PartFiles.push_back (std::string (Path));
+      Streams.push_back (std::make_unique<raw_fd_ostream> (FD, true));
+      OSs.push_back (Streams.back ().get ());
+    }
+
+  /* Generate code for the partitions.  We must keep each local symbol
+     in the same partition as its users, since promoting it to a global
+     could conflict with a symbol of the same name in another unit.  */
+  auto TMFactory = [&] () {
+    return std::unique_ptr<TargetMachine>
+      (TM->getTarget ().createTargetMachine
+	 (Triple, TM->getTargetCPU (), TM->getTargetFeatureString (),
+	  TM->Options, TM->getRelocationModel (), TM->getCodeModel (),
+	  TM->getOptLevel ()));
+  };
+
+  splitCodeGen (*M, OSs, {}, TMFactory, CGFT_ObjectFile, true);
+
+  Streams.clear ();
+
+  /* Now combine the partitions into Filename.  */
+  SmallVector<StringRef, 12> Args = {*Linker, "-r", "-o", Filename};
+  std::string ErrMsg;
+
+  for (auto &F : PartFiles)
+    Args.push_back (F);
+
+  int Status = ExecuteAndWait (*Linker, Args, None, {}, 0, 0, &ErrMsg);
+  Cleanup ();
+  if (Status != 0)
+    return Fail ("relocatable link failed"
+		 + (ErrMsg.empty () ? Twine ("") : Twine (": ") + ErrMsg));
+
+  return 0;
+}
+
+/* Support for the compilation cache.  Compute into Key, which has room
+   for 40 characters, a hash identifying the result of compiling M: that
+   of its bitcode, of Options, which describes everything else that
+   affects code generation, of the version of LLVM, and of the contents
+   of each file named in Files, a newline-separated list.  */
+
+extern "C"
+void
+Get_Module_Cache_Key (Module *M, const char *Options, const char *Files,
+		      char *Key)
+{
+  SmallVector<char, 0> Buffer;
+  raw_svector_ostream OS (Buffer);
+  SmallVector<StringRef, 4> FileNames;
+  SHA1 Hasher;
+
+  WriteBitcodeToFile (*M, OS);
+  Hasher.update (StringRef (Buffer.data (), Buffer.size ()));
+  Hasher.update (Options);
+  Hasher.update (LLVM_VERSION_STRING);
+
+  StringRef (Files).split (FileNames, '\n', -1, false);
+  for (StringRef Name : FileNames)
+    {
+      Hasher.update (Name);
+      if (auto MB = MemoryBuffer::getFile (Name))
+	Hasher.update ((*MB)->getBuffer ());
+    }
+
+  std::string Hex = toHex (Hasher.final (), true);
+  memcpy (Key, Hex.data (), 40);
+}
+
+/* Copy CacheFile, the output of a previous compilation, to Filename.
+   Return true if we did so.  */
+
+extern "C"
+LLVMBool
+Copy_From_Cache (const char *CacheFile, const char *Filename)
+{
+  return fs::exists (CacheFile) && !fs::copy_file (CacheFile, Filename);
+}
+
+/* Save a copy of Filename, the output of this compilation, as CacheFile.
+   We write it under a temporary name first, so that concurrent
+   compilations never see a partial file.  Return true and set
+   ErrorMessage if we can't do that.  */
+
+extern "C"
+LLVMBool
+Store_In_Cache (const char *Filename, const char *CacheFile,
+		char **ErrorMessage)
+{
+  SmallString<128> TempFile;
+  int FD;
+  std::error_code EC;
+
+  if (!(EC = fs::create_directories (path::parent_path (CacheFile))))
+    EC = fs::createUniqueFile (Twine (CacheFile) + ".%%%%%%", FD, TempFile);
+
+  if (!EC)
+    {
+      EC = fs::copy_file (Filename, FD);
+      Process::SafelyCloseFileDescriptor (FD);
+      if (!EC)
+	EC = fs::rename (TempFile, CacheFile);
+      if (EC)
+	fs::remove (TempFile);
+    }
+
+  if (EC)
+    {
+      *ErrorMessage = strdup (EC.message ().c_str ());
+      return 1;
+    }
+
+  return 0;
+}
+
+/* Link into M those functions of the bitcode library in Filename (for
+   nvptx, the CUDA libdevice) that M uses, in a form from which they can
+   only be inlined.  We load the library lazily so that we only read the
+   functions we need and keep the contents of the file in memory in case
+   we're asked to do this again.  Return true and set ErrorMessage if we
+   can't do that.  */
+
+static StringMap<std::unique_ptr<MemoryBuffer>> LibraryBuffers;
+
+extern "C"
+LLVMBool
+Link_Libdevice (Module *M, const char *Filename, char **ErrorMessage)
+{
+  auto Fail = [&] (const Twine &Msg) {
+    *ErrorMessage = strdup (Msg.str ().c_str ());
+    return 1;
+  };
+  auto &Buffer = LibraryBuffers[Filename];
+
+  if (!Buffer)
+    {
+      auto MB = MemoryBuffer::getFile (Filename);
+      if (!MB)
+	return Fail ("could not read `" + Twine (Filename) + "`: "
+		     + MB.getError ().message ());
+      Buffer = std::move (*MB);
+    }
+
+  auto Lib = getLazyBitcodeModule (Buffer->getMemBufferRef (),
+				   M->getContext ());
+  if (!Lib)
+    return Fail ("could not parse `" + Twine (Filename) + "`: "
+		 + toString (Lib.takeError ()));
+
+  /* Make the library agree with us on the target and only link in the
+     functions that we reference, directly or indirectly.  Each of those
+     is only there to be inlined.  Record which functions come from the
+     library so we can find them after linking; looking at them doesn't
+     cause them to be read.  */
+  StringSet<> LibFunctions;
+
+  (*Lib)->setDataLayout (M->getDataLayout ());
+  (*Lib)->setTargetTriple (M->getTargetTriple ());
+  for (Function &F : **Lib)
+    {
+      Function *Ours = M->getFunction (F.getName ());
+      if (!F.isDeclaration () && (!Ours || Ours->isDeclaration ()))
+	LibFunctions.insert (F.getName ());
+    }
+
+  if (Linker::linkModules (*M, std::move (*Lib), Linker::LinkOnlyNeeded))
+    return Fail ("could not merge `" + Twine (Filename) + "`");
+
+  for (auto &Name : LibFunctions)
+    if (Function *F = M->getFunction (Name.getKey ()))
+      if (!F->isDeclaration ())
+	{
+	  F->setLinkage (GlobalValue::AvailableExternallyLinkage);
+	  F->addFnAttr (Attribute::AlwaysInline);
+	}
+
+  return 0;
+}
+
+/* Return the bit that the x86 runtime uses in __cpu_model to say that
+   the processor has the feature named Name, or -1 if it doesn't record
+   that feature.  */
+
+static int
+Get_X86_Feature_Bit (StringRef Name)
+{
+  return StringSwitch<int> (Name)
+#define X86_FEATURE_COMPAT(ENUM, STR, PRIORITY) \
+    .Case (STR, X86::FEATURE_##ENUM)
+#include "llvm/Support/X86TargetParser.def"
+    .Default (-1);
+}
+
+/* Emit code, at the position of Builder, to test whether the processor
+   we're running on has all the features in Mask, in the format of the
+   result of X86::getCpuSupportsMask.  This is how clang expands
+   __builtin_cpu_supports.  */
+
+static Value *
+Emit_X86_CPU_Supports (IRBuilder<> &Builder, Module *M, uint64_t Mask)
+{
+  Type *Int32Ty = Builder.getInt32Ty ();
+  uint32_t Mask1 = Lo_32 (Mask), Mask2 = Hi_32 (Mask);
+  Value *Result = Builder.getTrue ();
+
+  if (Mask1 != 0)
+    {
+      StructType *ModelTy
+	= StructType::get (Int32Ty, Int32Ty, Int32Ty,
+			   ArrayType::get (Int32Ty, 1));
+      auto *Model = cast<GlobalValue> (M->getOrInsertGlobal ("__cpu_model",
+							     ModelTy));
+      Model->setDSOLocal (true);
+      Value *Idxs[] = {Builder.getInt32 (0), Builder.getInt32 (3),
+		       Builder.getInt32 (0)};
+      Value *Features
+	= Builder.CreateAlignedLoad (Int32Ty,
+				     Builder.CreateInBoundsGEP (ModelTy, Model,
+								Idxs),
+				     Align (4));
+      Value *Bits = Builder.CreateAnd (Features, Mask1);
+      Result = Builder.CreateAnd (Result,
+				  Builder.CreateICmpEQ (Bits,
+							Builder.getInt32 (Mask1)));
+    }
+
+  if (Mask2 != 0)
+    {
+      auto *Features2
+	= cast<GlobalValue> (M->getOrInsertGlobal ("__cpu_features2",
+						   Int32Ty));
+      Features2->setDSOLocal (true);
+      Value *Features
+	= Builder.CreateAlignedLoad (Int32Ty, Features2, Align (4));
+      Value *Bits = Builder.CreateAnd (Features, Mask2);
+      Result = Builder.CreateAnd (Result,
+				  Builder.CreateICmpEQ (Bits,
+							Builder.getInt32 (Mask2)));
+    }
+
+  return Result;
+}
+
+/* Replace each function F defined in M that has a "target-clones"
+   attribute, whose value is a comma-separated list of x86 processor
+   features, possibly including "default", by a clone of F for each
+   feature, compiled as if we had added it to Features, and a copy of F
+   as it is for "default".  F's name then designates an indirect function
+   whose resolver chooses, when the program is loaded, the clone for the
+   best feature that the processor supports.  Return true and set
+   ErrorMessage if we can't do that.  */
+
+extern "C"
+LLVMBool
+Expand_Target_Clones (Module *M, const char *Features, char **ErrorMessage)
+{
+  const char *Attr = "target-clones";
+  Triple T (M->getTargetTriple ());
+  SmallVector<Function *, 4> ToClone;
+
+  for (Function &F : *M)
+    if (F.hasFnAttribute (Attr))
+      {
+	/* A body available for inlining from another unit is only a copy:
+	   that unit expands it.  */
+	if (!F.isDeclaration () && !F.hasAvailableExternallyLinkage ())
+	  ToClone.push_back (&F);
+	else
+	  F.removeFnAttr (Attr);
+      }
+
+  if (ToClone.empty ())
+    return 0;
+
+  if (!T.isX86 () || !T.isOSBinFormatELF ())
+    {
+      *ErrorMessage = strdup ("target_clones is only supported for x86 "
+			      "ELF targets");
+      return 1;
+    }
+
+  for (Function *F : ToClone)
+    {
+      std::string Name = F->getName ().str ();
+      StringRef Targets = F->getFnAttribute (Attr).getValueAsString ();
+      StringRef BaseFeatures
+	= (F->hasFnAttribute ("target-features")
+	   ? F->getFnAttribute ("target-features").getValueAsString ()
+	   : StringRef (Features));
+      SmallVector<StringRef, 4> Names;
+      struct Clone { Function *F; uint64_t Mask; unsigned Priority; };
+      SmallVector<Clone, 4> Clones;
+
+      /* Make a clone for each feature other than "default".  */
+      Targets.split (Names, ',', -1, false);
+      for (StringRef Feature : Names)
+	{
+	  Feature = Feature.trim ();
+	  if (Feature == "default")
+	    continue;
+
+	  int Bit = Get_X86_Feature_Bit (Feature);
+	  if (Bit < 0 || Bit >= 64)
+	    {
+	      *ErrorMessage = strdup (("unknown processor feature `"
+				       + Feature + "` in target_clones for `"
+				       + Name + "`").str ().c_str ());
+	      return 1;
+	    }
+
+	  ValueToValueMapTy VMap;
+	  Function *NewF = CloneFunction (F, VMap);
+	  NewF->setName (Name + "." + Feature);
+	  NewF->setLinkage (GlobalValue::InternalLinkage);
+	  NewF->removeFnAttr (Attr);
+	  NewF->addFnAttr ("target-features",
+			   (BaseFeatures.empty () ? "+" + Feature
+			    : BaseFeatures + ",+" + Feature).str ());
+	  Clones.push_back ({NewF, 1ULL << Bit,
+			     X86::getFeaturePriority
+			     ((X86::ProcessorFeatures) Bit)});
+	}
+
+      /* Test the clones for the most capable features first.  */
+      llvm::stable_sort (Clones, [] (const Clone &A, const Clone &B) {
+	return A.Priority > B.Priority;
+      });
+
+      /* Now make F the default version and make its name designate an
+	 indirect function, whose resolver we then write.  */
+      PointerType *FnPtrTy = F->getType ();
+      GlobalValue::LinkageTypes Linkage = F->getLinkage ();
+      Function *Resolver
+	= Function::Create (FunctionType::get (FnPtrTy, false),
+			    GlobalValue::InternalLinkage, Name + ".resolver",
+			    M);
+
+      F->removeFnAttr (Attr);
+      F->setName (Name + ".default");
+      F->setLinkage (GlobalValue::InternalLinkage);
+      GlobalIFunc *IFunc
+	= GlobalIFunc::create (F->getFunctionType (), F->getAddressSpace (),
+			       Linkage, Name, Resolver, M);
+      F->replaceAllUsesWith (IFunc);
+
+      IRBuilder<> Builder (BasicBlock::Create (M->getContext (), "",
+					       Resolver));
+      Builder.CreateCall (M->getOrInsertFunction ("__cpu_indicator_init",
+						  Builder.getVoidTy ()));
+      for (Clone &C : Clones)
+	{
+	  BasicBlock *Yes
+	    = BasicBlock::Create (M->getContext (), "", Resolver);
+	  BasicBlock *No
+	    = BasicBlock::Create (M->getContext (), "", Resolver);
+
+	  Builder.CreateCondBr (Emit_X86_CPU_Supports (Builder, M, C.Mask),
+				Yes, No);
+	  Builder.SetInsertPoint (Yes);
+	  Builder.CreateRet (C.F);
+	  Builder.SetInsertPoint (No);
+	}
+
+      Builder.CreateRet (F);
+    }
+
+  return 0;
+}
+
 extern "C"
 Value *
 Get_Float_From_Words_And_Exp (LLVMContext *Context, Type *T, int Exp,